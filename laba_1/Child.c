@@ -7,23 +7,298 @@
 #include <ctype.h>
 #include <math.h>
 #include <float.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "float_format.h"
+#include "result_format.h"
+#include "frame_format.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHILD_X86_SIMD 1
+#endif
 
-#define MAX_NUMBERS 100
 #define MAX_NUM_LENGTH 64
-#define BUFFER_SIZE 4096
+#define READ_BUFFER_SIZE (64 * 1024)
+#define OUTPUT_FLUSH_SIZE (64 * 1024)
+#define OUTPUT_LINE_MAX 256
+
+#define FAST_MAX_DIGITS 19
+#define FAST_MAX_EXPONENT 10
+#define FAST_MAX_MANTISSA (UINT32_C(1) << 24)
+
+typedef struct
+{
+    const char* (*find_newline)(const char* p, const char* end);
+    const char* (*skip_spaces)(const char* p, const char* end);
+    const char* (*find_space)(const char* p, const char* end);
+    bool fast_parse;
+} scanner_t;
+
+static scanner_t scanner;
+
+typedef struct
+{
+    char* data;
+    size_t length;
+    size_t flush_size;
+} output_buffer_t;
+
+static output_buffer_t output;
+
+static bool shortest_format;
+static bool binary_output;
+
+// Время по этапам (флаг -t). На x86 используется счётчик TSC: он дешевле
+// clock_gettime, поэтому им можно мерить даже форматирование одной строки.
+// В секунды такты переводятся по общему времени работы.
+typedef struct
+{
+    bool enabled;
+    bool in_process;
+    uint64_t start_ticks;
+    double start_seconds;
+    uint64_t read_ticks;
+    uint64_t process_ticks;
+    uint64_t format_ticks;
+    uint64_t write_ticks;
+    uint64_t process_write_ticks;
+    uint64_t bytes;
+    uint64_t lines;
+} stage_stats_t;
+
+static stage_stats_t stats;
+
+typedef struct
+{
+    char text[MAX_NUM_LENGTH];
+    int32_t length;
+} token_buffer_t;
+
+// Состояние текущей строки: числа суммируются по мере разбора, поэтому
+// длина строки и количество чисел в ней ничем не ограничены. Хранится
+// только токен, разрезанный границей буфера чтения.
+typedef struct
+{
+    int32_t number;
+    int32_t count;
+    float sum;
+    bool has_chars;
+    bool in_token;
+    token_buffer_t token;
+} line_state_t;
+
+static line_state_t line;
+
+static inline bool is_space_char(char c)
+{
+    return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+static const char* find_newline_scalar(const char* p, const char* end)
+{
+    while (p < end && *p != '\n')
+    {
+        ++p;
+    }
+    return p;
+}
+
+static const char* skip_spaces_scalar(const char* p, const char* end)
+{
+    while (p < end && is_space_char(*p))
+    {
+        ++p;
+    }
+    return p;
+}
+
+static const char* find_space_scalar(const char* p, const char* end)
+{
+    while (p < end && !is_space_char(*p))
+    {
+        ++p;
+    }
+    return p;
+}
+
+#ifdef CHILD_X86_SIMD
+
+// Маска пробельных символов isspace() в локали "C": ' ' и '\t'..'\r'.
+static inline uint32_t space_mask_sse2(__m128i v)
+{
+    __m128i blank = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8('\r' - '\t')), shifted);
+    return (uint32_t)_mm_movemask_epi8(_mm_or_si128(blank, control));
+}
+
+static const char* find_newline_sse2(const char* p, const char* end)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return find_newline_scalar(p, end);
+}
+
+static const char* skip_spaces_sse2(const char* p, const char* end)
+{
+    for (; end - p >= 16; p += 16)
+    {
+        uint32_t mask = ~space_mask_sse2(_mm_loadu_si128((const __m128i*)p)) & 0xFFFFu;
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return skip_spaces_scalar(p, end);
+}
+
+static const char* find_space_sse2(const char* p, const char* end)
+{
+    for (; end - p >= 16; p += 16)
+    {
+        uint32_t mask = space_mask_sse2(_mm_loadu_si128((const __m128i*)p));
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return find_space_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t space_mask_avx2(__m256i v)
+{
+    __m256i blank = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+    __m256i shifted = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+    __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8('\r' - '\t')), shifted);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(blank, control));
+}
+
+__attribute__((target("avx2")))
+static const char* find_newline_avx2(const char* p, const char* end)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for (; end - p >= 32; p += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return find_newline_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char* skip_spaces_avx2(const char* p, const char* end)
+{
+    for (; end - p >= 32; p += 32)
+    {
+        uint32_t mask = ~space_mask_avx2(_mm256_loadu_si256((const __m256i*)p));
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return skip_spaces_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char* find_space_avx2(const char* p, const char* end)
+{
+    for (; end - p >= 32; p += 32)
+    {
+        uint32_t mask = space_mask_avx2(_mm256_loadu_si256((const __m256i*)p));
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return find_space_sse2(p, end);
+}
+
+#endif
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static inline uint64_t stage_ticks(void)
+{
+#ifdef CHILD_X86_SIMD
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static void report_stats(void)
+{
+    double elapsed = now_seconds() - stats.start_seconds;
+    uint64_t ticks = stage_ticks() - stats.start_ticks;
+    double per_tick = ticks > 0 ? elapsed / ticks : 0.0;
+
+    uint64_t parse_ticks = stats.process_ticks - stats.format_ticks - stats.process_write_ticks;
+    char msg[512];
+    int32_t len = snprintf(msg, sizeof(msg),
+                           "child: bytes=%llu lines=%llu seconds=%.6f read_seconds=%.6f "
+                           "parse_seconds=%.6f format_seconds=%.6f write_seconds=%.6f\n",
+                           (unsigned long long)stats.bytes,
+                           (unsigned long long)(stats.lines + (uint64_t)line.number), elapsed,
+                           stats.read_ticks * per_tick, parse_ticks * per_tick,
+                           stats.format_ticks * per_tick, stats.write_ticks * per_tick);
+    write(STDERR_FILENO, msg, len);
+}
+
+static void select_scanner(bool force_scalar)
+{
+    scanner = (scanner_t){find_newline_scalar, skip_spaces_scalar, find_space_scalar, false};
+    if (force_scalar)
+    {
+        return;
+    }
 
+#ifdef CHILD_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        scanner = (scanner_t){find_newline_avx2, skip_spaces_avx2, find_space_avx2, true};
+        return;
+    }
+    scanner = (scanner_t){find_newline_sse2, skip_spaces_sse2, find_space_sse2, true};
+#else
+    scanner.fast_parse = true;
+#endif
+}
 
 bool parse_float(const char* str, float* result)
 {
     char* endptr;
     float value = strtof(str, &endptr);
-    
+
 
     if (endptr == str)
     {
         return false;
     }
-    
+
     while (*endptr != '\0')
     {
         if (!isspace(*endptr))
@@ -32,142 +307,751 @@ bool parse_float(const char* str, float* result)
         }
         endptr++;
     }
-    
-    if (value == HUGE_VALF || value == -HUGE_VALF || value == 0.0f)
-    {
-        return true;
-    }
-    
+
     *result = value;
     return true;
 }
 
-int32_t float_to_string(float num, char* str, int precision)
+// Разбор числа прямо во входном буфере, без копирования токена.
+// Если мантисса не больше 2^24, а порядок в [-10, 10], и мантисса, и 10^|порядок|
+// точно представимы во float, и одно умножение/деление во float округляется
+// один раз — ровно как strtof. Через double так нельзя: двойное округление
+// (сначала до double, потом до float) ошибается у середин между float.
+// Для остальных случаев возвращается false, и токен разбирается по-старому.
+static bool parse_float_fast(const char* p, const char* end, float* result)
 {
-    if (isnan(num))
+    static const float powers_of_ten[FAST_MAX_EXPONENT + 1] = {
+        1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f,
+    };
+
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-'))
     {
-        return snprintf(str, MAX_NUM_LENGTH, "nan");
+        negative = *p == '-';
+        ++p;
     }
-    
-    if (isinf(num))
+
+    uint64_t mantissa = 0;
+    int32_t digits = 0;
+    int32_t exponent = 0;
+    bool seen_digit = false;
+    bool seen_point = false;
+
+    for (; p < end; ++p)
     {
-        if (num > 0)
-            return snprintf(str, MAX_NUM_LENGTH, "inf");
+        char c = *p;
+        if (c >= '0' && c <= '9')
+        {
+            seen_digit = true;
+            if (mantissa == 0 && c == '0')
+            {
+                exponent -= seen_point;
+                continue;
+            }
+            if (digits == FAST_MAX_DIGITS)
+            {
+                return false;
+            }
+            mantissa = mantissa * 10 + (uint64_t)(c - '0');
+            ++digits;
+            exponent -= seen_point;
+        }
+        else if (c == '.' && !seen_point)
+        {
+            seen_point = true;
+        }
         else
-            return snprintf(str, MAX_NUM_LENGTH, "-inf");
+        {
+            break;
+        }
+    }
+
+    if (!seen_digit)
+    {
+        return false;
     }
-    
 
-    return snprintf(str, MAX_NUM_LENGTH, "%.*f", precision, num);
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        ++p;
+        bool exponent_negative = false;
+        if (p < end && (*p == '+' || *p == '-'))
+        {
+            exponent_negative = *p == '-';
+            ++p;
+        }
+        if (p == end)
+        {
+            return false;
+        }
+
+        int32_t value = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        {
+            if (value < 10000)
+            {
+                value = value * 10 + (*p - '0');
+            }
+        }
+        exponent += exponent_negative ? -value : value;
+    }
+
+    if (p != end)
+    {
+        return false;
+    }
+
+    if (mantissa == 0)
+    {
+        *result = negative ? -0.0f : 0.0f;
+        return true;
+    }
+
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD != 0
+    // Промежуточный результат шире float (x87) — снова двойное округление
+    return false;
+#endif
+    if (mantissa > FAST_MAX_MANTISSA || exponent < -FAST_MAX_EXPONENT || exponent > FAST_MAX_EXPONENT)
+    {
+        return false;
+    }
+
+    float value = (float)mantissa;
+    value = exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+    *result = negative ? -value : value;
+    return true;
 }
 
-void process_line(const char* line, int32_t length)
+// Исходная семантика токена: символы, не входящие в запись числа,
+// пропускаются, длина ограничена MAX_NUM_LENGTH - 1, разбор через strtof.
+static void token_append(token_buffer_t* token, const char* p, const char* end)
 {
-    float numbers[MAX_NUMBERS];
-    int32_t count = 0;
-    
-    char num_buffer[MAX_NUM_LENGTH];
-    int32_t num_index = 0;
-    
-    for (int32_t i = 0; i < length; ++i)
+    for (; p < end; ++p)
     {
-        char c = line[i];
-        
-        if ((c >= '0' && c <= '9') || 
-            c == '-' || c == '+' || 
-            c == '.' || 
+        char c = *p;
+        if ((c >= '0' && c <= '9') ||
+            c == '-' || c == '+' ||
+            c == '.' ||
             c == 'e' || c == 'E')
         {
-            if (num_index < MAX_NUM_LENGTH - 1)
+            if (token->length < MAX_NUM_LENGTH - 1)
             {
-                num_buffer[num_index++] = c;
+                token->text[token->length++] = c;
             }
         }
-        else if (isspace(c))
+    }
+}
+
+static bool token_parse(token_buffer_t* token, float* result)
+{
+    if (token->length == 0)
+    {
+        return false;
+    }
+
+    token->text[token->length] = '\0';
+    return parse_float(token->text, result);
+}
+
+static bool parse_token_slow(const char* p, const char* end, float* result)
+{
+    token_buffer_t token = {.length = 0};
+    token_append(&token, p, end);
+    return token_parse(&token, result);
+}
+
+static bool parse_token(const char* p, const char* end, float* result)
+{
+    if (scanner.fast_parse && end - p < MAX_NUM_LENGTH && parse_float_fast(p, end, result))
+    {
+        return true;
+    }
+    return parse_token_slow(p, end, result);
+}
+
+static bool output_init(size_t flush_size)
+{
+    output.data = malloc(flush_size + OUTPUT_LINE_MAX);
+    output.length = 0;
+    output.flush_size = flush_size;
+    return output.data != NULL;
+}
+
+static void output_flush(void)
+{
+    uint64_t started = stats.enabled ? stage_ticks() : 0;
+    const char* data = output.data;
+    size_t size = output.length;
+    while (size > 0)
+    {
+        ssize_t written = write(STDOUT_FILENO, data, size);
+        if (written < 0)
         {
-            if (num_index > 0)
-            {
-                num_buffer[num_index] = '\0';
-                float num;
-                if (parse_float(num_buffer, &num) && count < MAX_NUMBERS)
-                {
-                    numbers[count++] = num;
-                }
-                num_index = 0;
-            }
+            const char msg[] = "error: failed to write to stdout\n";
+            write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            exit(EXIT_FAILURE);
         }
+        data += written;
+        size -= written;
+    }
+    output.length = 0;
+
+    if (stats.enabled)
+    {
+        uint64_t spent = stage_ticks() - started;
+        stats.write_ticks += spent;
+        if (stats.in_process)
+        {
+            stats.process_write_ticks += spent;
+        }
+    }
+}
+
+// Строка результата целиком дописывается в буфер (места под неё всегда
+// хватает: OUTPUT_LINE_MAX сверх порога), сброс происходит по порогу.
+static inline void output_line_done(void)
+{
+    if (output.length >= output.flush_size)
+    {
+        output_flush();
     }
+}
+
+static inline void output_append(const char* data, size_t size)
+{
+    memcpy(output.data + output.length, data, size);
+    output.length += size;
+}
 
-    if (num_index > 0)
+// Для длинных данных (имя файла), которые могут не поместиться в запас
+// буфера сверх порога: дописывает по частям со сбросом.
+static void output_append_long(const char* data, size_t size)
+{
+    size_t capacity = output.flush_size + OUTPUT_LINE_MAX;
+    while (size > 0)
     {
-        num_buffer[num_index] = '\0';
+        if (output.length == capacity)
+        {
+            output_flush();
+        }
+        size_t part = capacity - output.length < size ? capacity - output.length : size;
+        output_append(data, part);
+        data += part;
+        size -= part;
+    }
+}
+
+static inline void output_append_int(int32_t value)
+{
+    char digits[12];
+    int32_t pos = sizeof(digits);
+    uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    do
+    {
+        digits[--pos] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0)
+    {
+        digits[--pos] = '-';
+    }
+    output_append(digits + pos, sizeof(digits) - pos);
+}
+
+static inline void line_add(float num)
+{
+    line.sum += num;
+    line.count++;
+}
+
+static void line_finish_token(void)
+{
+    float num;
+    if (token_parse(&line.token, &num))
+    {
+        line_add(num);
+    }
+    line.token.length = 0;
+    line.in_token = false;
+}
+
+// Разбирает кусок строки [p, end). Если строка на этом куске не
+// заканчивается (line_ends == false), последний токен может продолжиться
+// в следующем буфере и откладывается в line.token.
+static void process_segment(const char* p, const char* end, bool line_ends)
+{
+    if (p < end)
+    {
+        line.has_chars = true;
+    }
+
+    if (line.in_token)
+    {
+        const char* token_end = scanner.find_space(p, end);
+        token_append(&line.token, p, token_end);
+        p = token_end;
+        if (p == end && !line_ends)
+        {
+            return;
+        }
+        line_finish_token();
+    }
+
+    for (;;)
+    {
+        p = scanner.skip_spaces(p, end);
+        if (p == end)
+        {
+            break;
+        }
+
+        const char* token_end = scanner.find_space(p, end);
+        if (token_end == end && !line_ends)
+        {
+            line.in_token = true;
+            token_append(&line.token, p, end);
+            break;
+        }
+
         float num;
-        if (parse_float(num_buffer, &num) && count < MAX_NUMBERS)
+        if (parse_token(p, token_end, &num))
         {
-            numbers[count++] = num;
+            line_add(num);
         }
+        p = token_end;
     }
-    
-    float sum = 0.0f;
-    for (int32_t i = 0; i < count; ++i)
+}
+
+static void write_text_result(void)
+{
+    static const char line_header[] = "Line ";
+    output_append(line_header, sizeof(line_header) - 1);
+    output_append_int(line.number);
+    output_append(": ", 2);
+
+    char result[FLOAT_FORMAT_MAX_LENGTH];
+    int32_t len = shortest_format
+        ? float_to_shortest(line.sum, result)
+        : float_to_string(line.sum, result, 6);
+
+    static const char prefix[] = "Sum of ";
+    static const char infix[] = " numbers: ";
+    output_append(prefix, sizeof(prefix) - 1);
+    output_append_int(line.count);
+    output_append(infix, sizeof(infix) - 1);
+    output_append(result, len);
+    output_append("\n", 1);
+}
+
+static void write_binary_result(void)
+{
+    result_record_t record = {(uint64_t)line.number, (uint32_t)line.count, line.sum};
+    result_encode_record((uint8_t*)output.data + output.length, &record);
+    output.length += RESULT_RECORD_SIZE;
+}
+
+static void finish_line(void)
+{
+    if (line.has_chars)
     {
-        sum += numbers[i];
+        line.number++;
+        uint64_t started = stats.enabled ? stage_ticks() : 0;
+        if (binary_output)
+        {
+            write_binary_result();
+        }
+        else
+        {
+            write_text_result();
+        }
+        if (stats.enabled)
+        {
+            stats.format_ticks += stage_ticks() - started;
+        }
+        output_line_done();
     }
-    
-    char result[64];
-    int32_t len = float_to_string(sum, result, 6);
-    
-    char output[128];
-    int32_t output_len = snprintf(output, sizeof(output), 
-                                  "Sum of %d numbers: %s\n", count, result);
-    
-    write(STDOUT_FILENO, output, output_len);
+
+    line.count = 0;
+    line.sum = 0.0f;
+    line.has_chars = false;
 }
 
-int main(void)
+static void process_buffer(const char* p, const char* end)
 {
-    char buffer[BUFFER_SIZE];
-    char line[BUFFER_SIZE];
-    int32_t line_length = 0;
+    uint64_t started = 0;
+    if (stats.enabled)
+    {
+        stats.bytes += (uint64_t)(end - p);
+        stats.in_process = true;
+        started = stage_ticks();
+    }
+
+    while (p < end)
+    {
+        const char* newline = scanner.find_newline(p, end);
+        bool line_ends = newline != end;
+        process_segment(p, newline, line_ends);
+        if (!line_ends)
+        {
+            break;
+        }
+
+        finish_line();
+        p = newline + 1;
+    }
+
+    if (stats.enabled)
+    {
+        stats.process_ticks += stage_ticks() - started;
+        stats.in_process = false;
+    }
+}
+
+static int32_t process_stdin(void)
+{
+    static char buffer[READ_BUFFER_SIZE];
     ssize_t bytes;
-    
-    int32_t line_number = 0;
-    
-    while ((bytes = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0)
+
+    for (;;)
     {
-        for (int32_t i = 0; i < bytes; ++i)
+        uint64_t started = stats.enabled ? stage_ticks() : 0;
+        bytes = read(STDIN_FILENO, buffer, sizeof(buffer));
+        if (stats.enabled)
         {
-            if (buffer[i] == '\n')
+            stats.read_ticks += stage_ticks() - started;
+        }
+        if (bytes <= 0)
+        {
+            break;
+        }
+        process_buffer(buffer, buffer + bytes);
+    }
+
+    if (bytes < 0)
+    {
+        const char msg[] = "error: failed to read from stdin\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        return -1;
+    }
+    return 0;
+}
+
+// Пакетный режим (-F): на stdin несколько файлов в кадрах frame_format.h.
+// Перед каждым файлом выводится его заголовок, состояние строки
+// сбрасывается. Незавершённая последняя строка файла отбрасывается,
+// как и в обычном режиме на конце stdin.
+typedef struct
+{
+    char data[READ_BUFFER_SIZE];
+    size_t start;
+    size_t end;
+} input_buffer_t;
+
+static input_buffer_t input;
+
+static ssize_t input_fill(void)
+{
+    uint64_t started = stats.enabled ? stage_ticks() : 0;
+    ssize_t bytes = read(STDIN_FILENO, input.data, sizeof(input.data));
+    if (stats.enabled)
+    {
+        stats.read_ticks += stage_ticks() - started;
+    }
+    input.start = 0;
+    input.end = bytes > 0 ? (size_t)bytes : 0;
+    return bytes;
+}
+
+// 1 — прочитано, 0 — конец ввода до первого байта, -1 — ошибка или обрыв.
+static int32_t input_read_exact(void* dst, size_t size)
+{
+    char* p = dst;
+    size_t done = 0;
+    while (done < size)
+    {
+        if (input.start == input.end)
+        {
+            ssize_t bytes = input_fill();
+            if (bytes <= 0)
             {
-                if (line_length > 0)
-                {
-                    line_number++;
-                    char line_header[32];
-                    int32_t header_len = snprintf(line_header, sizeof(line_header), 
-                                                  "Line %d: ", line_number);
-                    write(STDOUT_FILENO, line_header, header_len);
-                    
-                    process_line(line, line_length);
-                    line_length = 0;
-                }
+                return bytes == 0 && done == 0 ? 0 : -1;
             }
-            else
+        }
+        size_t part = input.end - input.start;
+        if (part > size - done)
+        {
+            part = size - done;
+        }
+        memcpy(p + done, input.data + input.start, part);
+        input.start += part;
+        done += part;
+    }
+    return 1;
+}
+
+static bool process_frame_data(uint32_t length)
+{
+    while (length > 0)
+    {
+        if (input.start == input.end && input_fill() <= 0)
+        {
+            return false;
+        }
+        size_t part = input.end - input.start;
+        if (part > length)
+        {
+            part = length;
+        }
+        process_buffer(input.data + input.start, input.data + input.start + part);
+        input.start += part;
+        length -= (uint32_t)part;
+    }
+    return true;
+}
+
+static void reset_line(void)
+{
+    stats.lines += (uint64_t)line.number;
+    line = (line_state_t){0};
+}
+
+static void begin_file(uint32_t index, const char* name, uint32_t name_length)
+{
+    reset_line();
+
+    if (binary_output)
+    {
+        uint8_t section[RESULT_RECORD_SIZE + FRAME_NAME_MAX + RESULT_RECORD_SIZE];
+        result_encode_section(section, index, name, name_length);
+        output_append_long((const char*)section, result_section_size(name_length));
+    }
+    else
+    {
+        static const char file_header[] = "File: ";
+        output_append(file_header, sizeof(file_header) - 1);
+        output_append_long(name, name_length);
+        output_append_long("\n", 1);
+    }
+    output_line_done();
+}
+
+static int32_t process_framed(void)
+{
+    bool in_file = false;
+    char name[FRAME_NAME_MAX];
+    uint8_t header[FRAME_HEADER_SIZE];
+    int32_t status;
+
+    while ((status = input_read_exact(header, sizeof(header))) == 1)
+    {
+        uint8_t type;
+        uint32_t length;
+        frame_decode_header(header, &type, &length);
+
+        bool ok = false;
+        switch (type)
+        {
+        case FRAME_FILE_BEGIN:
             {
-                if (line_length < BUFFER_SIZE - 1)
+                uint8_t index[4];
+                ok = !in_file && length >= sizeof(index) && length - sizeof(index) <= sizeof(name) &&
+                     input_read_exact(index, sizeof(index)) == 1 &&
+                     input_read_exact(name, length - sizeof(index)) == 1;
+                if (ok)
                 {
-                    line[line_length++] = buffer[i];
+                    begin_file((uint32_t)result_load_le(index, 4), name, length - (uint32_t)sizeof(index));
+                    in_file = true;
                 }
             }
+            break;
+        case FRAME_FILE_DATA:
+            ok = in_file && process_frame_data(length);
+            break;
+        case FRAME_FILE_END:
+            ok = in_file && length == 0;
+            reset_line();
+            in_file = false;
+            break;
+        default:
+            break;
+        }
+
+        if (!ok)
+        {
+            status = -1;
+            break;
         }
     }
-    
-    if (bytes < 0)
+
+    if (status != 0 || in_file)
     {
-        const char msg[] = "error: failed to read from stdin\n";
+        const char msg[] = "error: malformed or truncated framed input\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        return -1;
+    }
+    return 0;
+}
+
+// Разбор файла прямо из отображения в память: дескриптор уже открыт
+// родителем, данные не копируются ни в pipe, ни в буфер чтения.
+// length < 0 означает "до конца файла".
+static int32_t process_mapped(int32_t fd, off_t offset, off_t length)
+{
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+    {
+        const char msg[] = "error: failed to stat input file\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        return -1;
+    }
+
+    if (offset > st.st_size)
+    {
+        offset = st.st_size;
+    }
+    if (length < 0 || length > st.st_size - offset)
+    {
+        length = st.st_size - offset;
+    }
+    if (length == 0)
+    {
+        return 0;
+    }
+
+    off_t page = sysconf(_SC_PAGESIZE);
+    off_t aligned = offset / page * page;
+    size_t map_size = (size_t)(length + (offset - aligned));
+
+    char* data = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, aligned);
+    if (data == MAP_FAILED)
+    {
+        const char msg[] = "error: failed to mmap input file\n";
         write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        return -1;
+    }
+
+    madvise(data, map_size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(data, map_size, MADV_HUGEPAGE);
+#endif
+
+    const char* begin = data + (offset - aligned);
+    process_buffer(begin, begin + length);
+
+    munmap(data, map_size);
+    return 0;
+}
+
+static void print_usage_and_exit(void)
+{
+    const char msg[] = "usage: child [-s] [-b flush_bytes] [-f fixed|shortest] [-B] [-t] [-F | -i fd [-o offset] [-n length]]\n";
+    write(STDERR_FILENO, msg, sizeof(msg) - 1);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char* argv[])
+{
+    bool force_scalar = false;
+    long flush_size = OUTPUT_FLUSH_SIZE;
+    int32_t input_fd = -1;
+    off_t input_offset = 0;
+    off_t input_length = -1;
+    bool framed = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "sb:f:BtFi:o:n:")) != -1)
+    {
+        switch (opt)
+        {
+        case 's':
+            force_scalar = true;
+            break;
+        case 'b':
+            flush_size = atol(optarg);
+            if (flush_size <= 0)
+            {
+                print_usage_and_exit();
+            }
+            break;
+        case 'f':
+            if (strcmp(optarg, "shortest") == 0)
+            {
+                shortest_format = true;
+            }
+            else if (strcmp(optarg, "fixed") != 0)
+            {
+                print_usage_and_exit();
+            }
+            break;
+        case 'B':
+            binary_output = true;
+            break;
+        case 't':
+            stats.enabled = true;
+            stats.start_seconds = now_seconds();
+            stats.start_ticks = stage_ticks();
+            break;
+        case 'F':
+            framed = true;
+            break;
+        case 'i':
+            input_fd = atoi(optarg);
+            break;
+        case 'o':
+            input_offset = (off_t)strtoll(optarg, NULL, 10);
+            break;
+        case 'n':
+            input_length = (off_t)strtoll(optarg, NULL, 10);
+            break;
+        default:
+            print_usage_and_exit();
+        }
+    }
+
+    if ((input_fd < 0 && (input_offset != 0 || input_length >= 0)) || (framed && input_fd >= 0))
+    {
+        print_usage_and_exit();
+    }
+    select_scanner(force_scalar);
+
+    if (!output_init((size_t)flush_size))
+    {
+        const char msg[] = "error: failed to allocate output buffer\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        exit(EXIT_FAILURE);
+    }
+
+    if (binary_output)
+    {
+        result_encode_header((uint8_t*)output.data);
+        output.length = RESULT_HEADER_SIZE;
+    }
+
+    int32_t result;
+    if (framed)
+    {
+        result = process_framed();
+    }
+    else if (input_fd >= 0)
+    {
+        result = process_mapped(input_fd, input_offset, input_length);
+    }
+    else
+    {
+        result = process_stdin();
+    }
+
+    output_flush();
+
+    if (stats.enabled)
+    {
+        report_stats();
+    }
+
+    if (result != 0)
+    {
         exit(EXIT_FAILURE);
     }
-    
-    
+
+
     return 0;
 }
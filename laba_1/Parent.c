@@ -1,141 +1,1708 @@
+#define _GNU_SOURCE
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <poll.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "result_format.h"
+#include "frame_format.h"
+#include "uring.h"
+
+#define TRANSFER_BUFFER_SIZE 4096
+#define SPLICE_CHUNK_SIZE (1 << 20)
+#define MERGE_BUFFER_SIZE (64 * 1024)
+#define MAX_JOBS 256
+#define BATCH_BUFFER_SIZE (64 * 1024)
+#define URING_BUFFERS 8
+#define URING_BUFFER_SIZE (128 * 1024)
 
 char CHILD_PROGRAM_NAME[] = "./child";
 
-int main()
+typedef enum
 {
-    char filename[256];
+    TRANSFER_COPY,
+    TRANSFER_SPLICE,
+    TRANSFER_MMAP,
+    TRANSFER_URING,
+} transfer_mode_t;
+
+typedef struct
+{
+    transfer_mode_t mode;
+    int32_t pipe_size;
+    int32_t jobs;
+    bool stats;
+    bool binary;
+    bool cold;
+    char** files;
+    int32_t file_count;
+} parent_options_t;
+
+typedef struct
+{
+    off_t offset;
+    uint64_t length;
+} file_range_t;
+
+#define WHOLE_FILE ((file_range_t){-1, UINT64_MAX})
+
+typedef struct
+{
+    uint64_t bytes;
+    double seconds;
+    double read_seconds;
+    double pipe_seconds;
+    bool fallback;
+} transfer_stats_t;
+
+static const char* transfer_mode_name(transfer_mode_t mode)
+{
+    switch (mode)
     {
-        const char prompt[] = "Enter filename: ";
-        write(STDOUT_FILENO, prompt, sizeof(prompt) - 1);
+    case TRANSFER_SPLICE:
+        return "splice";
+    case TRANSFER_MMAP:
+        return "mmap";
+    case TRANSFER_URING:
+        return "uring";
+    case TRANSFER_COPY:
+    default:
+        return "copy";
+    }
+}
 
-        ssize_t bytes = read(STDIN_FILENO, filename, sizeof(filename) - 1);
-        if (bytes <= 0)
+static void print_usage(const char* program)
+{
+    char msg[256];
+    int32_t len = snprintf(msg, sizeof(msg),
+                           "usage: %s [-m copy|splice|mmap|uring] [-p pipe_size] [-j jobs] [-s] [-B] [-c] [file...]\n",
+                           program);
+    write(STDERR_FILENO, msg, len);
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool write_all(int32_t fd, const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = write(fd, data, size);
+        if (written < 0)
         {
-            const char msg[] = "error: failed to read filename\n";
-            write(STDERR_FILENO, msg, sizeof(msg) - 1);
-            exit(EXIT_FAILURE);
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
         }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
 
-        if (filename[bytes - 1] == '\n')
+static size_t range_chunk(const file_range_t* range, uint64_t done, size_t limit)
+{
+    uint64_t left = range->length - done;
+    return left < limit ? (size_t)left : limit;
+}
+
+static int32_t transfer_copy(int32_t in, file_range_t range, int32_t out, transfer_stats_t* stats)
+{
+    char buf[TRANSFER_BUFFER_SIZE];
+    uint64_t done = 0;
+    ssize_t bytes = 0;
+
+    while (done < range.length)
+    {
+        size_t want = range_chunk(&range, done, sizeof(buf));
+        double started = now_seconds();
+        bytes = range.offset < 0
+            ? read(in, buf, want)
+            : pread(in, buf, want, range.offset + (off_t)done);
+        double was_read = now_seconds();
+        stats->read_seconds += was_read - started;
+        if (bytes <= 0)
         {
-            filename[bytes - 1] = '\0';
+            break;
         }
-        else
+        if (!write_all(out, buf, bytes))
         {
-            filename[bytes] = '\0';
+            const char msg[] = "error: failed to write to pipe\n";
+            write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            return -1;
         }
+        stats->pipe_seconds += now_seconds() - was_read;
+        done += bytes;
+        stats->bytes += bytes;
     }
 
-    int32_t file = open(filename, O_RDONLY);
-    if (file == -1)
+    if (done < range.length && bytes < 0)
     {
-        const char msg[] = "error: failed to open file\n";
+        const char msg[] = "error: failed to read from file\n";
         write(STDERR_FILENO, msg, sizeof(msg) - 1);
-        exit(EXIT_FAILURE);
+        return -1;
     }
 
+    return 0;
+}
 
-    int parent_to_child[2];
-    if (pipe(parent_to_child) == -1)
+// Данные идут из файла в pipe внутри ядра, минуя буфер процесса.
+// Если splice не поддерживается для этой пары дескрипторов, дочитываем
+// остаток обычным циклом read/write.
+static int32_t transfer_splice(int32_t in, file_range_t range, int32_t out, transfer_stats_t* stats)
+{
+    uint64_t done = 0;
+    while (done < range.length)
     {
-        const char msg[] = "error: failed to create pipe\n";
+        loff_t offset = range.offset + (loff_t)done;
+        double started = now_seconds();
+        ssize_t moved = splice(in, range.offset < 0 ? NULL : &offset, out, NULL,
+                               range_chunk(&range, done, SPLICE_CHUNK_SIZE), SPLICE_F_MOVE | SPLICE_F_MORE);
+        // Чтение и запись в pipe у splice не разделить, всё время — pipe.
+        stats->pipe_seconds += now_seconds() - started;
+        if (moved > 0)
+        {
+            done += moved;
+            stats->bytes += moved;
+            continue;
+        }
+        if (moved == 0)
+        {
+            return 0;
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        if (errno == EINVAL || errno == ENOSYS)
+        {
+            stats->fallback = true;
+            file_range_t rest = {range.offset < 0 ? -1 : range.offset + (off_t)done, range.length - done};
+            return transfer_copy(in, rest, out, stats);
+        }
+
+        const char msg[] = "error: failed to splice file into pipe\n";
         write(STDERR_FILENO, msg, sizeof(msg) - 1);
-        close(file);
-        exit(EXIT_FAILURE);
+        return -1;
     }
+    return 0;
+}
 
-    const pid_t child_pid = fork();
+// Буфер конвейера io_uring: читается из файла, затем пишется в pipe.
+// Чтения идут во все свободные буферы сразу, запись — одна за раз и строго
+// по порядку смещений, иначе данные в pipe перемешаются.
+typedef enum
+{
+    URING_BUFFER_FREE,
+    URING_BUFFER_READING,
+    URING_BUFFER_READY,
+    URING_BUFFER_WRITING,
+} uring_buffer_state_t;
 
-    switch (child_pid)
+typedef struct
+{
+    uring_buffer_state_t state;
+    uint64_t offset;
+    uint32_t want;
+    uint32_t filled;
+    uint32_t written;
+} uring_buffer_t;
+
+#define URING_WRITE_FLAG (UINT64_C(1) << 32)
+
+typedef struct
+{
+    uring_t ring;
+    bool fixed;
+    int32_t in;
+    int32_t out;
+    off_t base;
+    char* memory;
+    uring_buffer_t buffers[URING_BUFFERS];
+} uring_transfer_t;
+
+static bool uring_queue_read(uring_transfer_t* transfer, int32_t index)
+{
+    struct io_uring_sqe* sqe = uring_get_sqe(&transfer->ring);
+    if (sqe == NULL)
     {
-    case -1:
+        return false;
+    }
+    uring_buffer_t* buffer = &transfer->buffers[index];
+    sqe->opcode = transfer->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = transfer->in;
+    sqe->addr = (uint64_t)(uintptr_t)(transfer->memory + (size_t)index * URING_BUFFER_SIZE + buffer->filled);
+    sqe->len = buffer->want - buffer->filled;
+    sqe->off = (uint64_t)transfer->base + buffer->offset + buffer->filled;
+    sqe->buf_index = transfer->fixed ? (uint16_t)index : 0;
+    sqe->user_data = (uint64_t)index;
+    buffer->state = URING_BUFFER_READING;
+    return true;
+}
+
+static bool uring_queue_write(uring_transfer_t* transfer, int32_t index)
+{
+    struct io_uring_sqe* sqe = uring_get_sqe(&transfer->ring);
+    if (sqe == NULL)
+    {
+        return false;
+    }
+    uring_buffer_t* buffer = &transfer->buffers[index];
+    sqe->opcode = transfer->fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = transfer->out;
+    sqe->addr = (uint64_t)(uintptr_t)(transfer->memory + (size_t)index * URING_BUFFER_SIZE + buffer->written);
+    sqe->len = buffer->filled - buffer->written;
+    sqe->off = (uint64_t)-1;
+    sqe->buf_index = transfer->fixed ? (uint16_t)index : 0;
+    sqe->user_data = (uint64_t)index | URING_WRITE_FLAG;
+    buffer->state = URING_BUFFER_WRITING;
+    return true;
+}
+
+static int32_t transfer_uring_loop(uring_transfer_t* transfer, uint64_t length, transfer_stats_t* stats)
+{
+    uint64_t next_read = 0;
+    uint64_t next_write = 0;
+    bool writing = false;
+
+    for (;;)
+    {
+        for (int32_t i = 0; i < URING_BUFFERS && next_read < length; ++i)
         {
-            const char msg[] = "error: failed to spawn new process\n";
-            write(STDERR_FILENO, msg, sizeof(msg) - 1);
-            close(file);
-            close(parent_to_child[0]);
-            close(parent_to_child[1]);
-            exit(EXIT_FAILURE);
+            uring_buffer_t* buffer = &transfer->buffers[i];
+            if (buffer->state != URING_BUFFER_FREE)
+            {
+                continue;
+            }
+            uint64_t left = length - next_read;
+            *buffer = (uring_buffer_t){.offset = next_read,
+                                       .want = left < URING_BUFFER_SIZE ? (uint32_t)left : URING_BUFFER_SIZE};
+            if (!uring_queue_read(transfer, i))
+            {
+                buffer->state = URING_BUFFER_FREE;
+                break;
+            }
+            next_read += buffer->want;
         }
-        break;
 
-    case 0:
+        for (int32_t i = 0; i < URING_BUFFERS && !writing; ++i)
         {
-            close(parent_to_child[1]);
-            close(file);
-            if (dup2(parent_to_child[0], STDIN_FILENO) == -1)
+            uring_buffer_t* buffer = &transfer->buffers[i];
+            if (buffer->state == URING_BUFFER_READY && buffer->offset == next_write)
             {
-                const char msg[] = "error: failed to redirect stdin\n";
-                write(STDERR_FILENO, msg, sizeof(msg) - 1);
-                exit(EXIT_FAILURE);
+                writing = uring_queue_write(transfer, i);
             }
-            close(parent_to_child[0]);
+        }
 
-            char* const args[] = {"child", NULL};
-            execv(CHILD_PROGRAM_NAME, args);
+        bool busy = writing;
+        for (int32_t i = 0; i < URING_BUFFERS; ++i)
+        {
+            busy |= transfer->buffers[i].state == URING_BUFFER_READING;
+        }
+        if (!busy)
+        {
+            return 0;
+        }
 
-            const char msg[] = "error: failed to exec into child program\n";
+        if (uring_submit_and_wait(&transfer->ring, 1) == -1)
+        {
+            const char msg[] = "error: io_uring_enter failed\n";
             write(STDERR_FILENO, msg, sizeof(msg) - 1);
-            exit(EXIT_FAILURE);
+            return -1;
         }
-        break;
 
-    default:
+        struct io_uring_cqe cqe;
+        while (uring_pop_cqe(&transfer->ring, &cqe))
         {
-            close(parent_to_child[0]);
-
-            char buf[4096];
-            ssize_t bytes;
-
+            int32_t index = (int32_t)(cqe.user_data & (URING_WRITE_FLAG - 1));
+            uring_buffer_t* buffer = &transfer->buffers[index];
+            bool retry = cqe.res == -EINTR || cqe.res == -EAGAIN;
 
-            while ((bytes = read(file, buf, sizeof(buf))) > 0)
+            if (cqe.user_data & URING_WRITE_FLAG)
             {
-                int32_t written = write(parent_to_child[1], buf, bytes);
-
-
-                if (written != bytes)
+                if (cqe.res < 0 && !retry)
                 {
                     const char msg[] = "error: failed to write to pipe\n";
                     write(STDERR_FILENO, msg, sizeof(msg) - 1);
-                    close(file);
-                    close(parent_to_child[1]);
-                    wait(NULL);
-                    exit(EXIT_FAILURE);
+                    return -1;
+                }
+                buffer->written += cqe.res > 0 ? (uint32_t)cqe.res : 0;
+                stats->bytes += cqe.res > 0 ? (uint64_t)cqe.res : 0;
+                if (buffer->written < buffer->filled)
+                {
+                    buffer->state = URING_BUFFER_READY;
                 }
+                else
+                {
+                    next_write += buffer->filled;
+                    buffer->state = URING_BUFFER_FREE;
+                }
+                writing = false;
+                continue;
             }
 
-            if (bytes < 0)
+            if (cqe.res < 0 && !retry)
             {
                 const char msg[] = "error: failed to read from file\n";
                 write(STDERR_FILENO, msg, sizeof(msg) - 1);
+                return -1;
+            }
+            if (cqe.res == 0)
+            {
+                // Конец файла: дальше этого буфера читать нечего, чтения
+                // за концом вернут 0 и освободят свои буферы.
+                length = buffer->offset + buffer->filled;
+                if (next_read > length)
+                {
+                    next_read = length;
+                }
             }
+            buffer->filled += cqe.res > 0 ? (uint32_t)cqe.res : 0;
 
-            close(file);
-            close(parent_to_child[1]);
+            if (buffer->filled == 0 && buffer->offset >= length)
+            {
+                buffer->state = URING_BUFFER_FREE;
+            }
+            else if (buffer->filled < buffer->want && buffer->offset + buffer->filled < length)
+            {
+                if (!uring_queue_read(transfer, index))
+                {
+                    buffer->state = URING_BUFFER_READY;
+                }
+            }
+            else
+            {
+                buffer->state = URING_BUFFER_READY;
+            }
+        }
+    }
+}
+
+// Чтение файла и запись в pipe перекрываются: пока ребёнок разбирает одни
+// буферы, следующие уже читаются с диска. Буферы регистрируются в ядре
+// (READ_FIXED/WRITE_FIXED); если не вышло — обычные READ/WRITE. Без
+// io_uring или для файла без смещений работает обычный цикл read/write.
+static int32_t transfer_uring(int32_t in, file_range_t range, int32_t out, transfer_stats_t* stats)
+{
+    uring_transfer_t transfer = {.in = in, .out = out, .base = range.offset};
+    if (transfer.base < 0)
+    {
+        transfer.base = lseek(in, 0, SEEK_CUR);
+    }
+
+    size_t memory_size = (size_t)URING_BUFFERS * URING_BUFFER_SIZE;
+    transfer.memory = transfer.base < 0 ? MAP_FAILED
+        : mmap(NULL, memory_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (transfer.memory == MAP_FAILED || uring_init(&transfer.ring, URING_BUFFERS * 2) == -1)
+    {
+        if (transfer.memory != MAP_FAILED)
+        {
+            munmap(transfer.memory, memory_size);
+        }
+        stats->fallback = true;
+        return transfer_copy(in, range, out, stats);
+    }
+
+    struct iovec iov[URING_BUFFERS];
+    for (int32_t i = 0; i < URING_BUFFERS; ++i)
+    {
+        iov[i] = (struct iovec){transfer.memory + (size_t)i * URING_BUFFER_SIZE, URING_BUFFER_SIZE};
+    }
+    transfer.fixed = uring_register_buffers(&transfer.ring, iov, URING_BUFFERS) == 0;
+
+    int32_t result = transfer_uring_loop(&transfer, range.length, stats);
+
+    uring_close(&transfer.ring);
+    munmap(transfer.memory, memory_size);
+    return result;
+}
+
+static int32_t transfer(const parent_options_t* options, int32_t in, file_range_t range, int32_t out, transfer_stats_t* stats)
+{
+    switch (options->mode)
+    {
+    case TRANSFER_SPLICE:
+        return transfer_splice(in, range, out, stats);
+    case TRANSFER_URING:
+        return transfer_uring(in, range, out, stats);
+    default:
+        return transfer_copy(in, range, out, stats);
+    }
+}
+
+// Холодный кэш (-c): страницы файла выбрасываются из page cache перед
+// передачей, чтобы сравнивать режимы на чтении с диска.
+static void drop_file_cache(const parent_options_t* options, int32_t file)
+{
+    if (options->cold)
+    {
+        posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+    }
+}
+
+static void report_transfer(const char* label, const parent_options_t* options, int32_t pipe_size,
+                            const transfer_stats_t* stats)
+{
+    double rate = stats->seconds > 0 ? stats->bytes / stats->seconds : 0.0;
+    char msg[256];
+    int32_t len = snprintf(msg, sizeof(msg),
+                           "%s: mode=%s%s jobs=%d pipe_size=%d bytes=%llu seconds=%.6f "
+                           "read_seconds=%.6f pipe_seconds=%.6f rate=%.0f B/s (%.2f MB/s)\n",
+                           label,
+                           transfer_mode_name(options->mode),
+                           stats->fallback ? "(fallback=copy)" : "",
+                           options->jobs,
+                           pipe_size,
+                           (unsigned long long)stats->bytes,
+                           stats->seconds, stats->read_seconds, stats->pipe_seconds,
+                           rate, rate / (1024.0 * 1024.0));
+    write(STDERR_FILENO, msg, len);
+}
 
-            int status;
-            wait(&status);
+static bool parse_options(int argc, char* argv[], parent_options_t* options)
+{
+    options->mode = TRANSFER_COPY;
+    options->pipe_size = 0;
+    options->jobs = 1;
+    options->stats = false;
+    options->binary = false;
+    options->cold = false;
 
-            if (WIFEXITED(status))
+    int opt;
+    while ((opt = getopt(argc, argv, "m:p:j:sBc")) != -1)
+    {
+        switch (opt)
+        {
+        case 'm':
+            if (strcmp(optarg, "copy") == 0)
+            {
+                options->mode = TRANSFER_COPY;
+            }
+            else if (strcmp(optarg, "splice") == 0)
+            {
+                options->mode = TRANSFER_SPLICE;
+            }
+            else if (strcmp(optarg, "mmap") == 0)
             {
-                exit(WEXITSTATUS(status));
+                options->mode = TRANSFER_MMAP;
+            }
+            else if (strcmp(optarg, "uring") == 0)
+            {
+                options->mode = TRANSFER_URING;
             }
             else
             {
-                const char msg[] = "error: child terminated abnormally\n";
-                write(STDERR_FILENO, msg, sizeof(msg) - 1);
-                exit(EXIT_FAILURE);
+                return false;
+            }
+            break;
+        case 'p':
+            options->pipe_size = atoi(optarg);
+            if (options->pipe_size <= 0)
+            {
+                return false;
+            }
+            break;
+        case 'j':
+            options->jobs = atoi(optarg);
+            if (options->jobs <= 0 || options->jobs > MAX_JOBS)
+            {
+                return false;
             }
+            break;
+        case 's':
+            options->stats = true;
+            break;
+        case 'B':
+            options->binary = true;
+            break;
+        case 'c':
+            options->cold = true;
+            break;
+        default:
+            return false;
         }
-        break;
     }
 
+    options->files = argv + optind;
+    options->file_count = argc - optind;
+    return true;
+}
+
+static int32_t make_pipe(const parent_options_t* options, int fds[2])
+{
+    if (pipe(fds) == -1)
+    {
+        const char msg[] = "error: failed to create pipe\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        return -1;
+    }
+
+    if (options->pipe_size > 0 && fcntl(fds[1], F_SETPIPE_SZ, options->pipe_size) == -1)
+    {
+        const char msg[] = "warning: failed to resize pipe, using default size\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+    }
     return 0;
 }
+
+// Вызывается в дочернем процессе после fork: подменяет stdin и stdout
+// (отрицательный дескриптор оставляет поток как есть) и запускает
+// программу ребёнка. Не возвращается.
+static void exec_child(int32_t input_fd, int32_t output_fd, char* const args[])
+{
+    if ((input_fd >= 0 && dup2(input_fd, STDIN_FILENO) == -1) ||
+        (output_fd >= 0 && dup2(output_fd, STDOUT_FILENO) == -1))
+    {
+        const char msg[] = "error: failed to redirect stdio\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        exit(EXIT_FAILURE);
+    }
+    if (input_fd >= 0)
+    {
+        close(input_fd);
+    }
+    if (output_fd >= 0)
+    {
+        close(output_fd);
+    }
+
+    execv(CHILD_PROGRAM_NAME, args);
+
+    const char msg[] = "error: failed to exec into child program\n";
+    write(STDERR_FILENO, msg, sizeof(msg) - 1);
+    exit(EXIT_FAILURE);
+}
+
+static void exec_pipe_child(const parent_options_t* options, int32_t input_fd, int32_t output_fd, bool framed)
+{
+    char* args[5] = {"child"};
+    int32_t count = 1;
+    if (framed)
+    {
+        args[count++] = "-F";
+    }
+    if (options->stats)
+    {
+        args[count++] = "-t";
+    }
+    if (options->binary)
+    {
+        args[count++] = "-B";
+    }
+    exec_child(input_fd, output_fd, args);
+}
+
+// Режим mmap: ребёнок получает номер уже открытого дескриптора файла
+// и свой диапазон, pipe используется только для результатов.
+static void exec_mapped_child(const parent_options_t* options, int32_t file, file_range_t range, int32_t output_fd)
+{
+    char fd_arg[16];
+    char offset_arg[24];
+    char length_arg[24];
+    snprintf(fd_arg, sizeof(fd_arg), "%d", file);
+    snprintf(offset_arg, sizeof(offset_arg), "%lld", (long long)(range.offset < 0 ? 0 : range.offset));
+    snprintf(length_arg, sizeof(length_arg), "%lld",
+             range.length == UINT64_MAX ? -1LL : (long long)range.length);
+
+    char* args[10] = {"child", "-i", fd_arg, "-o", offset_arg, "-n", length_arg};
+    int32_t count = 7;
+    if (options->stats)
+    {
+        args[count++] = "-t";
+    }
+    if (options->binary)
+    {
+        args[count++] = "-B";
+    }
+    exec_child(-1, output_fd, args);
+}
+
+static int32_t exit_code_from_status(int status)
+{
+    if (WIFEXITED(status))
+    {
+        return WEXITSTATUS(status);
+    }
+
+    const char msg[] = "error: child terminated abnormally\n";
+    write(STDERR_FILENO, msg, sizeof(msg) - 1);
+    return EXIT_FAILURE;
+}
+
+static int32_t run_single_mapped(const parent_options_t* options, int32_t file)
+{
+    double started = now_seconds();
+
+    const pid_t child_pid = fork();
+    if (child_pid == -1)
+    {
+        const char msg[] = "error: failed to spawn new process\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        return EXIT_FAILURE;
+    }
+    if (child_pid == 0)
+    {
+        exec_mapped_child(options, file, WHOLE_FILE, -1);
+    }
+
+    int status;
+    waitpid(child_pid, &status, 0);
+
+    if (options->stats)
+    {
+        struct stat st;
+        transfer_stats_t stats = {.seconds = now_seconds() - started};
+        if (fstat(file, &st) == 0)
+        {
+            stats.bytes = (uint64_t)st.st_size;
+        }
+        report_transfer("transfer", options, 0, &stats);
+    }
+
+    return exit_code_from_status(status);
+}
+
+static int32_t run_single(const parent_options_t* options, int32_t file)
+{
+    if (options->mode == TRANSFER_MMAP)
+    {
+        return run_single_mapped(options, file);
+    }
+
+    int parent_to_child[2];
+    if (make_pipe(options, parent_to_child) == -1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    const pid_t child_pid = fork();
+
+    switch (child_pid)
+    {
+    case -1:
+        {
+            const char msg[] = "error: failed to spawn new process\n";
+            write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            close(parent_to_child[0]);
+            close(parent_to_child[1]);
+            return EXIT_FAILURE;
+        }
+
+    case 0:
+        close(parent_to_child[1]);
+        close(file);
+        exec_pipe_child(options, parent_to_child[0], -1, false);
+        break;
+
+    default:
+        break;
+    }
+
+    close(parent_to_child[0]);
+
+    transfer_stats_t stats = {0};
+    double started = now_seconds();
+    int32_t result = transfer(options, file, WHOLE_FILE, parent_to_child[1], &stats);
+    stats.seconds = now_seconds() - started;
+    if (options->stats)
+    {
+        report_transfer("transfer", options, fcntl(parent_to_child[1], F_GETPIPE_SZ), &stats);
+    }
+
+    close(parent_to_child[1]);
+
+    int status;
+    waitpid(child_pid, &status, 0);
+
+    int32_t code = exit_code_from_status(status);
+    return result != 0 ? EXIT_FAILURE : code;
+}
+
+// Делит файл на jobs кусков по границам строк: каждая граница сдвигается
+// вперёд до позиции сразу после ближайшего '\n'.
+static int32_t split_file(int32_t file, uint64_t size, int32_t jobs, uint64_t* bounds)
+{
+    bounds[0] = 0;
+    bounds[jobs] = size;
+
+    for (int32_t i = 1; i < jobs; ++i)
+    {
+        uint64_t pos = size / jobs * i;
+        if (pos < bounds[i - 1])
+        {
+            pos = bounds[i - 1];
+        }
+
+        char buf[TRANSFER_BUFFER_SIZE];
+        bool found = false;
+        while (!found && pos < size)
+        {
+            ssize_t bytes = pread(file, buf, sizeof(buf), (off_t)pos);
+            if (bytes <= 0)
+            {
+                return -1;
+            }
+            const char* newline = memchr(buf, '\n', bytes);
+            if (newline != NULL)
+            {
+                pos += (uint64_t)(newline - buf) + 1;
+                found = true;
+            }
+            else
+            {
+                pos += bytes;
+            }
+        }
+        bounds[i] = pos;
+    }
+    return 0;
+}
+
+// Промежуточный процесс: запускает ребёнка на своём куске файла, сам
+// подаёт ему кусок через pipe и завершается с кодом ребёнка.
+static void run_feeder(const parent_options_t* options, int32_t file, file_range_t range, int32_t output_fd)
+{
+    int feeder_to_child[2];
+    if (make_pipe(options, feeder_to_child) == -1)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    const pid_t child_pid = fork();
+    if (child_pid == -1)
+    {
+        const char msg[] = "error: failed to spawn new process\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        exit(EXIT_FAILURE);
+    }
+    if (child_pid == 0)
+    {
+        close(feeder_to_child[1]);
+        close(file);
+        exec_pipe_child(options, feeder_to_child[0], output_fd, false);
+    }
+
+    close(feeder_to_child[0]);
+    close(output_fd);
+
+    transfer_stats_t stats = {0};
+    double started = now_seconds();
+    int32_t result = transfer(options, file, range, feeder_to_child[1], &stats);
+    stats.seconds = now_seconds() - started;
+    if (options->stats)
+    {
+        report_transfer("feeder", options, fcntl(feeder_to_child[1], F_GETPIPE_SZ), &stats);
+    }
+    close(feeder_to_child[1]);
+    close(file);
+
+    int status;
+    waitpid(child_pid, &status, 0);
+    int32_t code = exit_code_from_status(status);
+    exit(result != 0 ? EXIT_FAILURE : code);
+}
+
+typedef struct
+{
+    int32_t fd;
+    char* data;
+    size_t length;
+    size_t capacity;
+    uint64_t lines;
+    bool header_done;
+    bool in_section;
+    bool eof;
+} worker_output_t;
+
+static bool append_output(worker_output_t* worker, const char* data, size_t size)
+{
+    if (worker->length + size > worker->capacity)
+    {
+        size_t capacity = worker->capacity ? worker->capacity : MERGE_BUFFER_SIZE;
+        while (capacity < worker->length + size)
+        {
+            capacity *= 2;
+        }
+        char* grown = realloc(worker->data, capacity);
+        if (grown == NULL)
+        {
+            return false;
+        }
+        worker->data = grown;
+        worker->capacity = capacity;
+    }
+    memcpy(worker->data + worker->length, data, size);
+    worker->length += size;
+    return true;
+}
+
+// Выводит завершённые строки результата, заменяя локальный номер строки
+// ребёнка "Line N:" на глобальный base + N.
+static bool emit_lines(worker_output_t* worker, uint64_t base, worker_output_t* out)
+{
+    static const char prefix[] = "Line ";
+    size_t start = 0;
+
+    for (;;)
+    {
+        const char* line = worker->data + start;
+        const char* newline = memchr(line, '\n', worker->length - start);
+        if (newline == NULL)
+        {
+            break;
+        }
+        size_t line_length = (size_t)(newline - line) + 1;
+
+        const char* rest = line;
+        uint64_t number = 0;
+        if (line_length > sizeof(prefix) - 1 && memcmp(line, prefix, sizeof(prefix) - 1) == 0)
+        {
+            const char* p = line + sizeof(prefix) - 1;
+            while (*p >= '0' && *p <= '9')
+            {
+                number = number * 10 + (uint64_t)(*p - '0');
+                ++p;
+            }
+            if (*p == ':')
+            {
+                rest = p;
+                worker->lines = number;
+            }
+        }
+
+        if (rest != line)
+        {
+            char header[32];
+            int32_t header_len = snprintf(header, sizeof(header), "Line %llu",
+                                          (unsigned long long)(base + number));
+            if (!append_output(out, header, header_len))
+            {
+                return false;
+            }
+        }
+        if (!append_output(out, rest, line_length - (size_t)(rest - line)))
+        {
+            return false;
+        }
+        start += line_length;
+    }
+
+    memmove(worker->data, worker->data + start, worker->length - start);
+    worker->length -= start;
+    return true;
+}
+
+// Заголовок каждого ребёнка отбрасывается: общий заголовок выводит
+// родитель. first — смещение первой записи после заголовка.
+static bool skip_child_header(worker_output_t* worker, size_t* first)
+{
+    *first = 0;
+    if (worker->header_done || worker->length < RESULT_HEADER_SIZE)
+    {
+        return true;
+    }
+    if (!result_check_header((const uint8_t*)worker->data))
+    {
+        const char msg[] = "error: child produced an invalid binary header\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        return false;
+    }
+    worker->header_done = true;
+    *first = RESULT_HEADER_SIZE;
+    return true;
+}
+
+// Двоичный вариант: номера строк в записях сдвигаются на base.
+static bool emit_records(worker_output_t* worker, uint64_t base, worker_output_t* out)
+{
+    size_t first;
+    if (!skip_child_header(worker, &first))
+    {
+        return false;
+    }
+    if (!worker->header_done)
+    {
+        return true;
+    }
+
+    size_t start = first;
+    for (; worker->length - start >= RESULT_RECORD_SIZE; start += RESULT_RECORD_SIZE)
+    {
+        uint8_t* data = (uint8_t*)worker->data + start;
+        result_record_t record;
+        result_decode_record(data, &record);
+        worker->lines = record.line_number;
+        record.line_number += base;
+        result_encode_record(data, &record);
+    }
+
+    if (!append_output(out, worker->data + first, start - first))
+    {
+        return false;
+    }
+    memmove(worker->data, worker->data + start, worker->length - start);
+    worker->length -= start;
+    return true;
+}
+
+static bool flush_output(worker_output_t* out)
+{
+    bool ok = write_all(STDOUT_FILENO, out->data, out->length);
+    out->length = 0;
+    return ok;
+}
+
+// Дочитывает всё, что готово в pipe детей: выводы читаются одновременно,
+// чтобы ни один ребёнок не заблокировался на заполненном pipe.
+static int32_t read_workers(worker_output_t* workers, int32_t jobs)
+{
+    struct pollfd fds[MAX_JOBS];
+    char buf[MERGE_BUFFER_SIZE];
+
+    nfds_t count = 0;
+    for (int32_t i = 0; i < jobs; ++i)
+    {
+        if (!workers[i].eof)
+        {
+            fds[count].fd = workers[i].fd;
+            fds[count].events = POLLIN;
+            ++count;
+        }
+    }
+
+    if (count > 0 && poll(fds, count, -1) == -1)
+    {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    nfds_t polled = 0;
+    for (int32_t i = 0; i < jobs; ++i)
+    {
+        if (workers[i].eof)
+        {
+            continue;
+        }
+        if (fds[polled++].revents == 0)
+        {
+            continue;
+        }
+
+        ssize_t bytes = read(workers[i].fd, buf, sizeof(buf));
+        if (bytes < 0 && errno != EINTR)
+        {
+            return -1;
+        }
+        if (bytes == 0)
+        {
+            workers[i].eof = true;
+            close(workers[i].fd);
+        }
+        else if (bytes > 0 && !append_output(&workers[i], buf, bytes))
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Печатает выводы детей строго по порядку кусков.
+static int32_t merge_outputs(const parent_options_t* options, worker_output_t* workers, int32_t jobs)
+{
+    worker_output_t out = {0};
+    int32_t current = 0;
+    uint64_t base = 0;
+
+    bool (*emit)(worker_output_t*, uint64_t, worker_output_t*) = emit_lines;
+    if (options->binary)
+    {
+        uint8_t header[RESULT_HEADER_SIZE];
+        result_encode_header(header);
+        if (!append_output(&out, (const char*)header, sizeof(header)))
+        {
+            return -1;
+        }
+        emit = emit_records;
+    }
+
+    while (current < jobs)
+    {
+        if (read_workers(workers + current, jobs - current) == -1)
+        {
+            return -1;
+        }
+
+        while (current < jobs)
+        {
+            if (!emit(&workers[current], base, &out))
+            {
+                return -1;
+            }
+            if (!workers[current].eof)
+            {
+                break;
+            }
+            if (!append_output(&out, workers[current].data, workers[current].length))
+            {
+                return -1;
+            }
+            base += workers[current].lines;
+            free(workers[current].data);
+            ++current;
+        }
+
+        if (!flush_output(&out))
+        {
+            return -1;
+        }
+    }
+
+    free(out.data);
+    return 0;
+}
+
+// Тело процесса-исполнителя number: пишет результаты в output_fd и
+// завершается, не возвращаясь.
+typedef void (*worker_body_t)(const parent_options_t* options, int32_t number, int32_t output_fd,
+                              const void* context);
+
+// Запускает jobs исполнителей, вывод каждого идёт в свой pipe. Возвращает
+// число запущенных; при ошибке запуска *code = EXIT_FAILURE, а pipe уже
+// запущенных закрыты.
+static int32_t spawn_workers(const parent_options_t* options, int32_t jobs, worker_body_t body,
+                             const void* context, worker_output_t* workers, pid_t* pids, int32_t* code)
+{
+    int32_t spawned = 0;
+    *code = EXIT_SUCCESS;
+
+    for (; spawned < jobs; ++spawned)
+    {
+        int child_to_parent[2];
+        if (pipe(child_to_parent) == -1)
+        {
+            const char msg[] = "error: failed to create pipe\n";
+            write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            *code = EXIT_FAILURE;
+            break;
+        }
+
+        pids[spawned] = fork();
+        if (pids[spawned] == -1)
+        {
+            const char msg[] = "error: failed to spawn new process\n";
+            write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            close(child_to_parent[0]);
+            close(child_to_parent[1]);
+            *code = EXIT_FAILURE;
+            break;
+        }
+        if (pids[spawned] == 0)
+        {
+            close(child_to_parent[0]);
+            for (int32_t i = 0; i < spawned; ++i)
+            {
+                close(workers[i].fd);
+            }
+            body(options, spawned, child_to_parent[1], context);
+        }
+
+        close(child_to_parent[1]);
+        workers[spawned] = (worker_output_t){.fd = child_to_parent[0]};
+    }
+
+    if (*code != EXIT_SUCCESS)
+    {
+        for (int32_t i = 0; i < spawned; ++i)
+        {
+            close(workers[i].fd);
+        }
+    }
+    return spawned;
+}
+
+static int32_t wait_workers(const pid_t* pids, int32_t spawned, int32_t code)
+{
+    for (int32_t i = 0; i < spawned; ++i)
+    {
+        int status;
+        waitpid(pids[i], &status, 0);
+        int32_t worker_code = exit_code_from_status(status);
+        if (code == EXIT_SUCCESS)
+        {
+            code = worker_code;
+        }
+    }
+    return code;
+}
+
+typedef struct
+{
+    int32_t file;
+    const uint64_t* bounds;
+} parallel_context_t;
+
+static void run_chunk_worker(const parent_options_t* options, int32_t number, int32_t output_fd,
+                             const void* context)
+{
+    const parallel_context_t* parallel = context;
+    file_range_t range = {(off_t)parallel->bounds[number],
+                          parallel->bounds[number + 1] - parallel->bounds[number]};
+    if (options->mode == TRANSFER_MMAP)
+    {
+        exec_mapped_child(options, parallel->file, range, output_fd);
+    }
+    run_feeder(options, parallel->file, range, output_fd);
+}
+
+static int32_t run_parallel(const parent_options_t* options, int32_t file)
+{
+    struct stat st;
+    if (fstat(file, &st) == -1 || !S_ISREG(st.st_mode))
+    {
+        const char msg[] = "error: -j requires a regular file\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        return EXIT_FAILURE;
+    }
+
+    int32_t jobs = options->jobs;
+    uint64_t bounds[MAX_JOBS + 1];
+    if (split_file(file, (uint64_t)st.st_size, jobs, bounds) == -1)
+    {
+        const char msg[] = "error: failed to read from file\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        return EXIT_FAILURE;
+    }
+
+    double started = now_seconds();
+
+    worker_output_t workers[MAX_JOBS];
+    pid_t feeders[MAX_JOBS];
+    parallel_context_t context = {file, bounds};
+    int32_t code;
+    int32_t spawned = spawn_workers(options, jobs, run_chunk_worker, &context, workers, feeders, &code);
+
+    if (code == EXIT_SUCCESS && merge_outputs(options, workers, jobs) == -1)
+    {
+        const char msg[] = "error: failed to merge child outputs\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        code = EXIT_FAILURE;
+    }
+
+    code = wait_workers(feeders, spawned, code);
+
+    if (options->stats)
+    {
+        transfer_stats_t stats = {.bytes = (uint64_t)st.st_size, .seconds = now_seconds() - started};
+        report_transfer("transfer", options, options->pipe_size, &stats);
+    }
+
+    return code;
+}
+
+// Пакетный режим: файлы из списка идут одному постоянному ребёнку (или
+// каждому из -j детей — файлы i, i + jobs, ...) в кадрах frame_format.h,
+// без fork/exec на каждый файл. Кадры и содержимое мелких файлов
+// собираются в общий буфер, так что на много файлов приходится одна
+// запись в pipe.
+typedef struct
+{
+    int32_t fd;
+    size_t length;
+    transfer_stats_t* stats;
+    char data[BATCH_BUFFER_SIZE];
+} frame_writer_t;
+
+static bool writer_flush(frame_writer_t* writer)
+{
+    double started = now_seconds();
+    bool ok = write_all(writer->fd, writer->data, writer->length);
+    writer->stats->pipe_seconds += now_seconds() - started;
+    writer->length = 0;
+    if (!ok)
+    {
+        const char msg[] = "error: failed to write to pipe\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+    }
+    return ok;
+}
+
+static bool writer_reserve(frame_writer_t* writer, size_t size)
+{
+    return writer->length + size <= sizeof(writer->data) || writer_flush(writer);
+}
+
+static bool send_file_begin(frame_writer_t* writer, uint32_t index, const char* name)
+{
+    uint32_t name_length = (uint32_t)strlen(name);
+    if (!writer_reserve(writer, FRAME_HEADER_SIZE + 4 + name_length))
+    {
+        return false;
+    }
+    uint8_t* p = (uint8_t*)writer->data + writer->length;
+    frame_encode_header(p, FRAME_FILE_BEGIN, 4 + name_length);
+    result_store_le(p + FRAME_HEADER_SIZE, index, 4);
+    memcpy(p + FRAME_HEADER_SIZE + 4, name, name_length);
+    writer->length += FRAME_HEADER_SIZE + 4 + name_length;
+    return true;
+}
+
+static bool send_file_end(frame_writer_t* writer)
+{
+    if (!writer_reserve(writer, FRAME_HEADER_SIZE))
+    {
+        return false;
+    }
+    frame_encode_header((uint8_t*)writer->data + writer->length, FRAME_FILE_END, 0);
+    writer->length += FRAME_HEADER_SIZE;
+    return true;
+}
+
+// Файл читается прямо в буфер за заголовком кадра, каждый прочитанный
+// кусок — кадр FRAME_FILE_DATA. 0 — файл отправлен, 1 — ошибка чтения
+// файла (поток кадров при этом цел), -1 — ошибка записи в pipe.
+static int32_t send_file_copy(frame_writer_t* writer, int32_t file)
+{
+    for (;;)
+    {
+        if (!writer_reserve(writer, FRAME_HEADER_SIZE + TRANSFER_BUFFER_SIZE))
+        {
+            return -1;
+        }
+        uint8_t* header = (uint8_t*)writer->data + writer->length;
+        size_t room = sizeof(writer->data) - writer->length - FRAME_HEADER_SIZE;
+
+        double started = now_seconds();
+        ssize_t bytes = read(file, header + FRAME_HEADER_SIZE, room);
+        writer->stats->read_seconds += now_seconds() - started;
+        if (bytes < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytes < 0)
+        {
+            const char msg[] = "error: failed to read from file\n";
+            write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            return 1;
+        }
+        if (bytes == 0)
+        {
+            return 0;
+        }
+
+        frame_encode_header(header, FRAME_FILE_DATA, (uint32_t)bytes);
+        writer->length += FRAME_HEADER_SIZE + (size_t)bytes;
+        writer->stats->bytes += (uint64_t)bytes;
+    }
+}
+
+// Большие файлы в режиме splice: заголовок кадра объявляет длину куска
+// заранее, поэтому файл, укоротившийся во время отправки, — ошибка потока.
+static int32_t send_file_splice(frame_writer_t* writer, int32_t file, uint64_t size)
+{
+    for (uint64_t offset = 0; offset < size;)
+    {
+        uint32_t chunk = size - offset < SPLICE_CHUNK_SIZE ? (uint32_t)(size - offset) : SPLICE_CHUNK_SIZE;
+        if (!writer_reserve(writer, FRAME_HEADER_SIZE))
+        {
+            return -1;
+        }
+        frame_encode_header((uint8_t*)writer->data + writer->length, FRAME_FILE_DATA, chunk);
+        writer->length += FRAME_HEADER_SIZE;
+        if (!writer_flush(writer))
+        {
+            return -1;
+        }
+
+        transfer_stats_t part = {0};
+        if (transfer_splice(file, (file_range_t){(off_t)offset, chunk}, writer->fd, &part) == -1)
+        {
+            return -1;
+        }
+        writer->stats->bytes += part.bytes;
+        writer->stats->read_seconds += part.read_seconds;
+        writer->stats->pipe_seconds += part.pipe_seconds;
+        writer->stats->fallback |= part.fallback;
+        if (part.bytes != chunk)
+        {
+            const char msg[] = "error: file changed while sending\n";
+            write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            return -1;
+        }
+        offset += chunk;
+    }
+    return 0;
+}
+
+static int32_t feed_files(const parent_options_t* options, int32_t first, int32_t step, int32_t out,
+                          transfer_stats_t* stats)
+{
+    static frame_writer_t writer;
+    writer.fd = out;
+    writer.length = 0;
+    writer.stats = stats;
+
+    int32_t code = EXIT_SUCCESS;
+    for (int32_t i = first; i < options->file_count; i += step)
+    {
+        const char* name = options->files[i];
+        if (!send_file_begin(&writer, (uint32_t)i, name))
+        {
+            return EXIT_FAILURE;
+        }
+
+        int32_t sent = 1;
+        int32_t file = open(name, O_RDONLY);
+        if (file == -1)
+        {
+            char msg[FRAME_NAME_MAX + 64];
+            int32_t len = snprintf(msg, sizeof(msg), "error: failed to open file %s\n", name);
+            write(STDERR_FILENO, msg, len);
+        }
+        else
+        {
+            drop_file_cache(options, file);
+            struct stat st;
+            bool large = options->mode == TRANSFER_SPLICE && fstat(file, &st) == 0 &&
+                         S_ISREG(st.st_mode) && st.st_size > BATCH_BUFFER_SIZE;
+            sent = large
+                ? send_file_splice(&writer, file, (uint64_t)st.st_size)
+                : send_file_copy(&writer, file);
+            close(file);
+        }
+
+        if (sent == -1 || !send_file_end(&writer))
+        {
+            return EXIT_FAILURE;
+        }
+        if (sent != 0)
+        {
+            code = EXIT_FAILURE;
+        }
+    }
+
+    return writer_flush(&writer) ? code : EXIT_FAILURE;
+}
+
+// Запускает постоянного ребёнка (-F) и подаёт ему свою часть списка.
+// Вывод ребёнка — в output_fd (отрицательный — stdout родителя).
+static int32_t run_batch_child(const parent_options_t* options, int32_t first, int32_t step, int32_t output_fd,
+                               const char* label)
+{
+    int parent_to_child[2];
+    if (make_pipe(options, parent_to_child) == -1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    const pid_t child_pid = fork();
+    if (child_pid == -1)
+    {
+        const char msg[] = "error: failed to spawn new process\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        close(parent_to_child[0]);
+        close(parent_to_child[1]);
+        return EXIT_FAILURE;
+    }
+    if (child_pid == 0)
+    {
+        close(parent_to_child[1]);
+        exec_pipe_child(options, parent_to_child[0], output_fd, true);
+    }
+
+    close(parent_to_child[0]);
+    if (output_fd >= 0)
+    {
+        close(output_fd);
+    }
+
+    transfer_stats_t stats = {0};
+    double started = now_seconds();
+    int32_t result = feed_files(options, first, step, parent_to_child[1], &stats);
+    stats.seconds = now_seconds() - started;
+    if (options->stats)
+    {
+        report_transfer(label, options, fcntl(parent_to_child[1], F_GETPIPE_SZ), &stats);
+    }
+    close(parent_to_child[1]);
+
+    int status;
+    waitpid(child_pid, &status, 0);
+    int32_t code = exit_code_from_status(status);
+    return result != EXIT_SUCCESS ? result : code;
+}
+
+static void run_batch_worker(const parent_options_t* options, int32_t number, int32_t output_fd,
+                             const void* context)
+{
+    const int32_t* jobs = context;
+    exit(run_batch_child(options, number, *jobs, output_fd, "feeder"));
+}
+
+// Текстовая секция начинается строкой "File: имя", двоичная — записью
+// RESULT_SECTION_LINE. Выводит готовую часть текущей секции ребёнка;
+// *done — секция закончилась: началась следующая или вывод ребёнка
+// кончился.
+static bool emit_section_lines(worker_output_t* worker, worker_output_t* out, bool* done)
+{
+    static const char prefix[] = "File: ";
+    size_t start = 0;
+
+    for (;;)
+    {
+        const char* line = worker->data + start;
+        const char* newline = memchr(line, '\n', worker->length - start);
+        if (newline == NULL)
+        {
+            break;
+        }
+        size_t line_length = (size_t)(newline - line) + 1;
+        bool section = line_length > sizeof(prefix) - 1 && memcmp(line, prefix, sizeof(prefix) - 1) == 0;
+        if (section && worker->in_section)
+        {
+            worker->in_section = false;
+            *done = true;
+            break;
+        }
+        worker->in_section = true;
+        start += line_length;
+    }
+
+    if (!append_output(out, worker->data, start))
+    {
+        return false;
+    }
+    memmove(worker->data, worker->data + start, worker->length - start);
+    worker->length -= start;
+    return true;
+}
+
+static bool emit_section_records(worker_output_t* worker, worker_output_t* out, bool* done)
+{
+    size_t first;
+    if (!skip_child_header(worker, &first))
+    {
+        return false;
+    }
+    if (!worker->header_done)
+    {
+        return true;
+    }
+
+    size_t start = first;
+    while (worker->length - start >= RESULT_RECORD_SIZE)
+    {
+        const uint8_t* data = (const uint8_t*)worker->data + start;
+        size_t size = RESULT_RECORD_SIZE;
+        if (result_is_section(data))
+        {
+            if (worker->in_section)
+            {
+                worker->in_section = false;
+                *done = true;
+                break;
+            }
+            uint32_t index;
+            uint32_t name_length;
+            result_decode_section(data, &index, &name_length);
+            size = result_section_size(name_length);
+            if (worker->length - start < size)
+            {
+                break;
+            }
+        }
+        worker->in_section = true;
+        start += size;
+    }
+
+    if (!append_output(out, worker->data + first, start - first))
+    {
+        return false;
+    }
+    memmove(worker->data, worker->data + start, worker->length - start);
+    worker->length -= start;
+    return true;
+}
+
+// Файл i обработан ребёнком i % jobs: секции выводятся по порядку файлов.
+static int32_t merge_sections(const parent_options_t* options, worker_output_t* workers, int32_t jobs)
+{
+    worker_output_t out = {0};
+    int32_t current = 0;
+    int32_t result = 0;
+
+    bool (*emit)(worker_output_t*, worker_output_t*, bool*) = emit_section_lines;
+    if (options->binary)
+    {
+        uint8_t header[RESULT_HEADER_SIZE];
+        result_encode_header(header);
+        if (!append_output(&out, (const char*)header, sizeof(header)))
+        {
+            return -1;
+        }
+        emit = emit_section_records;
+    }
+
+    while (result == 0 && current < options->file_count)
+    {
+        result = read_workers(workers, jobs);
+
+        while (result == 0 && current < options->file_count)
+        {
+            worker_output_t* worker = &workers[current % jobs];
+            bool done = false;
+            if (!emit(worker, &out, &done))
+            {
+                result = -1;
+                break;
+            }
+            if (!done && worker->eof)
+            {
+                // Ребёнок завершился посреди секции: выводим остаток как есть.
+                done = append_output(&out, worker->data, worker->length);
+                worker->length = 0;
+                worker->in_section = false;
+                result = done ? 0 : -1;
+            }
+            if (!done)
+            {
+                break;
+            }
+            ++current;
+        }
+
+        if (!flush_output(&out))
+        {
+            result = -1;
+        }
+    }
+
+    for (int32_t i = 0; i < jobs; ++i)
+    {
+        if (!workers[i].eof)
+        {
+            close(workers[i].fd);
+        }
+        free(workers[i].data);
+    }
+    free(out.data);
+    return result;
+}
+
+static int32_t run_batch(const parent_options_t* options)
+{
+    for (int32_t i = 0; i < options->file_count; ++i)
+    {
+        size_t length = strlen(options->files[i]);
+        if (length > FRAME_NAME_MAX || memchr(options->files[i], '\n', length) != NULL)
+        {
+            const char msg[] = "error: file names must be at most 4096 bytes and contain no newlines\n";
+            write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            return EXIT_FAILURE;
+        }
+    }
+
+    int32_t jobs = options->jobs < options->file_count ? options->jobs : options->file_count;
+    if (jobs == 1)
+    {
+        return run_batch_child(options, 0, 1, -1, "transfer");
+    }
+
+    double started = now_seconds();
+
+    worker_output_t workers[MAX_JOBS];
+    pid_t feeders[MAX_JOBS];
+    int32_t code;
+    int32_t spawned = spawn_workers(options, jobs, run_batch_worker, &jobs, workers, feeders, &code);
+
+    if (code == EXIT_SUCCESS && merge_sections(options, workers, jobs) == -1)
+    {
+        const char msg[] = "error: failed to merge child outputs\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        code = EXIT_FAILURE;
+    }
+
+    code = wait_workers(feeders, spawned, code);
+
+    if (options->stats)
+    {
+        transfer_stats_t stats = {.seconds = now_seconds() - started};
+        report_transfer("transfer", options, options->pipe_size, &stats);
+    }
+
+    return code;
+}
+
+int main(int argc, char* argv[])
+{
+    parent_options_t options;
+    if (!parse_options(argc, argv, &options))
+    {
+        print_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    if (options.file_count > 0)
+    {
+        if (options.mode == TRANSFER_MMAP)
+        {
+            const char msg[] = "error: -m mmap takes a single file, not a file list\n";
+            write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            exit(EXIT_FAILURE);
+        }
+        exit(run_batch(&options));
+    }
+
+    char filename[256];
+    {
+        // В двоичном режиме stdout занят записями, подсказка идёт в stderr
+        const char prompt[] = "Enter filename: ";
+        write(options.binary ? STDERR_FILENO : STDOUT_FILENO, prompt, sizeof(prompt) - 1);
+
+        ssize_t bytes = read(STDIN_FILENO, filename, sizeof(filename) - 1);
+        if (bytes <= 0)
+        {
+            const char msg[] = "error: failed to read filename\n";
+            write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            exit(EXIT_FAILURE);
+        }
+
+        if (filename[bytes - 1] == '\n')
+        {
+            filename[bytes - 1] = '\0';
+        }
+        else
+        {
+            filename[bytes] = '\0';
+        }
+    }
+
+    int32_t file = open(filename, O_RDONLY);
+    if (file == -1)
+    {
+        const char msg[] = "error: failed to open file\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        exit(EXIT_FAILURE);
+    }
+    drop_file_cache(&options, file);
+
+    int32_t code = options.jobs > 1
+        ? run_parallel(&options, file)
+        : run_single(&options, file);
+
+    close(file);
+    exit(code);
+}
@@ -0,0 +1,240 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+
+#include "float_format.h"
+
+#define DEFAULT_SAMPLES 1000000
+#define DEFAULT_ROUNDS 5
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t* state)
+{
+    uint64_t z = (*state += UINT64_C(0x9E3779B97F4A7C15));
+    z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+}
+
+// Треть выборки — суммы, похожие на вывод ребёнка, треть — произвольные
+// конечные битовые образы float, треть — малые числа около нуля.
+// Первыми идут граничные значения.
+static void generate_samples(float* samples, int32_t count, uint64_t seed)
+{
+    static const float edges[] = {
+        0.0f, -0.0f, 1.0f, 0.5f, 2.5f, 0.1f, 1e-45f, -1e-45f, FLT_MIN, FLT_MAX, -FLT_MAX,
+        16777216.0f, 16777217.0f, 1e10f, 9.999999e37f, 0.0000005f, 0.0000015f, 123.4565f,
+    };
+    int32_t edge_count = (int32_t)(sizeof(edges) / sizeof(edges[0]));
+
+    uint64_t state = seed;
+    for (int32_t i = 0; i < count; ++i)
+    {
+        if (i < edge_count)
+        {
+            samples[i] = edges[i];
+            continue;
+        }
+
+        uint64_t r = next_random(&state);
+        switch (i % 3)
+        {
+        case 0:
+            samples[i] = (float)((double)(r >> 11) / (double)(UINT64_C(1) << 53) * 20000.0 - 10000.0);
+            break;
+        case 1:
+            {
+                uint32_t bits = (uint32_t)r;
+                if (((bits >> 23) & 0xFFu) == 0xFFu)
+                {
+                    bits &= ~(UINT32_C(1) << 30);
+                }
+                memcpy(&samples[i], &bits, sizeof(bits));
+            }
+            break;
+        default:
+            samples[i] = (float)((double)(int32_t)(r >> 40) * 1e-9);
+            break;
+        }
+    }
+}
+
+static int32_t significant_digits(const char* text)
+{
+    int32_t digits = 0;
+    int32_t zeros = 0;
+    bool leading = true;
+    for (const char* p = text; *p != '\0' && *p != 'e'; ++p)
+    {
+        if (*p < '0' || *p > '9')
+        {
+            continue;
+        }
+        if (leading && *p == '0')
+        {
+            continue;
+        }
+        leading = false;
+        if (*p == '0')
+        {
+            ++zeros;
+        }
+        else
+        {
+            digits += zeros + 1;
+            zeros = 0;
+        }
+    }
+    return digits;
+}
+
+static int32_t shortest_reference_digits(float value)
+{
+    char buf[64];
+    for (int32_t precision = 0; precision < 9; ++precision)
+    {
+        snprintf(buf, sizeof(buf), "%.*e", precision, value);
+        if (strtof(buf, NULL) == value)
+        {
+            return significant_digits(buf);
+        }
+    }
+    return 9;
+}
+
+static int32_t check_samples(const float* samples, int32_t count)
+{
+    int32_t failures = 0;
+    char expected[512];
+    char actual[512];
+
+    for (int32_t i = 0; i < count; ++i)
+    {
+        float value = samples[i];
+        // Все точности проверяем на каждом 64-м значении, %.6f — на всех.
+        for (int32_t precision = 0; precision <= 9; ++precision)
+        {
+            if (precision != 6 && i % 64 != 0)
+            {
+                continue;
+            }
+            snprintf(expected, sizeof(expected), "%.*f", precision, value);
+            float_to_string(value, actual, precision);
+            if (strcmp(expected, actual) != 0 && failures++ < 10)
+            {
+                printf("fixed mismatch: %a precision=%d snprintf=%s ours=%s\n",
+                       value, precision, expected, actual);
+            }
+        }
+
+        float_to_shortest(value, actual);
+        if ((strtof(actual, NULL) != value ||
+             significant_digits(actual) != shortest_reference_digits(value)) && failures++ < 10)
+        {
+            printf("shortest mismatch: %a ours=%s digits=%d expected_digits=%d\n",
+                   value, actual, significant_digits(actual), shortest_reference_digits(value));
+        }
+    }
+    return failures;
+}
+
+typedef int32_t (*format_fn)(float value, char* str);
+
+static int32_t format_fixed_snprintf(float value, char* str)
+{
+    return snprintf(str, FLOAT_FORMAT_MAX_LENGTH, "%.6f", value);
+}
+
+static int32_t format_fixed_ours(float value, char* str)
+{
+    return float_to_string(value, str, 6);
+}
+
+static int32_t format_shortest_snprintf(float value, char* str)
+{
+    return snprintf(str, FLOAT_FORMAT_MAX_LENGTH, "%.9g", value);
+}
+
+static double time_formatter(format_fn fn, const float* samples, int32_t count, int32_t rounds, uint64_t* sink)
+{
+    char buf[512];
+    double best = 0.0;
+    for (int32_t round = 0; round < rounds; ++round)
+    {
+        double started = now_seconds();
+        for (int32_t i = 0; i < count; ++i)
+        {
+            *sink += (uint64_t)fn(samples[i], buf) + (uint8_t)buf[0];
+        }
+        double elapsed = now_seconds() - started;
+        if (round == 0 || elapsed < best)
+        {
+            best = elapsed;
+        }
+    }
+    return best * 1e9 / count;
+}
+
+static void report(const char* name, double baseline_ns, double ours_ns)
+{
+    printf("%-10s snprintf %8.1f ns/op   float_format %8.1f ns/op   speedup %.2fx\n",
+           name, baseline_ns, ours_ns, baseline_ns / ours_ns);
+}
+
+int main(int argc, char* argv[])
+{
+    int32_t count = argc > 1 ? atoi(argv[1]) : DEFAULT_SAMPLES;
+    uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 10) : 42;
+    if (count <= 0)
+    {
+        fprintf(stderr, "usage: %s [samples] [seed]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    float* samples = malloc(sizeof(float) * count);
+    if (samples == NULL)
+    {
+        fprintf(stderr, "error: failed to allocate samples\n");
+        return EXIT_FAILURE;
+    }
+    generate_samples(samples, count, seed);
+
+    int32_t failures = check_samples(samples, count);
+    printf("checked %d values: %d mismatches\n", count, failures);
+
+    // Для фиксированного формата отдельно меряем "типичные" суммы:
+    // на огромных значениях %.6f печатает до 39 цифр целой части.
+    int32_t typical = 0;
+    float* sums = malloc(sizeof(float) * count);
+    for (int32_t i = 0; sums != NULL && i < count; ++i)
+    {
+        if (fabsf(samples[i]) < 1e9f)
+        {
+            sums[typical++] = samples[i];
+        }
+    }
+
+    uint64_t sink = 0;
+    report("fixed",
+           time_formatter(format_fixed_snprintf, sums, typical, DEFAULT_ROUNDS, &sink),
+           time_formatter(format_fixed_ours, sums, typical, DEFAULT_ROUNDS, &sink));
+    report("shortest",
+           time_formatter(format_shortest_snprintf, samples, count, DEFAULT_ROUNDS, &sink),
+           time_formatter(float_to_shortest, samples, count, DEFAULT_ROUNDS, &sink));
+    printf("(checksum %llu)\n", (unsigned long long)sink);
+
+    free(sums);
+    free(samples);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,103 @@
+#!/bin/bash
+# Бенчмарк конвейера Parent.c -> Child.c.
+#
+# Для каждого файла, режима передачи и числа процессов запускает
+# "parent -s" несколько раз и пишет строку CSV на каждый запуск:
+# пропускная способность (MB/s, строк/с) и время по этапам:
+#   read_s       чтение файла родителем (copy)
+#   pipe_s       запись в pipe родителем (copy, splice)
+#   child_read_s чтение pipe ребёнком
+#   parse_s      разбор чисел ребёнком
+#   format_s     форматирование результатов
+#   write_s      запись результатов ребёнком
+# При -j N время этапов — сумма по всем процессам. В режиме uring чтение
+# и запись в pipe перекрываются, поэтому read_s и pipe_s не разделяются.
+# С -c перед каждым запуском файл выбрасывается из page cache.
+#
+# usage: bench_pipeline.sh [-b build_dir] [-m "copy splice mmap uring"] [-j "1 2 4"]
+#                          [-r repeats] [-o results.csv] [-B] [-c] file...
+
+set -euo pipefail
+
+build_dir=.
+modes="copy splice mmap uring"
+jobs_list="1"
+repeats=3
+output=-
+binary=""
+cold=""
+
+usage() {
+    echo "usage: $0 [-b build_dir] [-m \"copy splice mmap uring\"] [-j \"1 2 4\"] [-r repeats] [-o results.csv] [-B] [-c] file..." >&2
+    exit 1
+}
+
+while getopts "b:m:j:r:o:Bc" opt; do
+    case $opt in
+        b) build_dir=$OPTARG ;;
+        m) modes=$OPTARG ;;
+        j) jobs_list=$OPTARG ;;
+        r) repeats=$OPTARG ;;
+        o) output=$OPTARG ;;
+        B) binary="-B" ;;
+        c) cold="-c" ;;
+        *) usage ;;
+    esac
+done
+shift $((OPTIND - 1))
+[ $# -gt 0 ] || usage
+
+# parent запускает ./child из текущей директории
+cd "$build_dir"
+[ -x ./parent ] && [ -x ./child ] || { echo "error: no parent/child in $build_dir" >&2; exit 1; }
+
+stats_file=$(mktemp)
+trap 'rm -f "$stats_file"' EXIT
+
+if [ "$output" != - ]; then
+    exec > "$output"
+fi
+
+echo "file,bytes,lines,mode,cache,jobs,run,wall_s,mb_s,lines_s,read_s,pipe_s,child_read_s,parse_s,format_s,write_s"
+
+for file in "$@"; do
+    bytes=$(stat -c %s "$file")
+    for mode in $modes; do
+        for jobs in $jobs_list; do
+            for run in $(seq 1 "$repeats"); do
+                started=$(date +%s.%N)
+                echo "$file" | ./parent -s -m "$mode" -j "$jobs" $binary $cold > /dev/null 2> "$stats_file"
+                finished=$(date +%s.%N)
+
+                # Строки вида "label: key=value ..."; итоговая строка
+                # transfer при -j > 1 не содержит времени этапов.
+                awk -v file="$file" -v bytes="$bytes" -v mode="$mode" -v cache="${cold:+cold}" -v jobs="$jobs" \
+                    -v run="$run" -v started="$started" -v finished="$finished" '
+                    {
+                        label = $1
+                        for (i = 2; i <= NF; ++i) {
+                            if (split($i, kv, "=") != 2) continue
+                            key = kv[1]; value = kv[2]
+                            if (label == "child:") {
+                                if (key == "lines") lines += value
+                                else if (key == "read_seconds") child_read += value
+                                else if (key == "parse_seconds") parse += value
+                                else if (key == "format_seconds") format += value
+                                else if (key == "write_seconds") write_time += value
+                            } else if (label == "feeder:" || (label == "transfer:" && jobs == 1)) {
+                                if (key == "read_seconds") read_time += value
+                                else if (key == "pipe_seconds") pipe += value
+                            }
+                        }
+                    }
+                    END {
+                        wall = finished - started
+                        printf "%s,%d,%d,%s,%s,%d,%d,%.6f,%.2f,%.0f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f\n",
+                               file, bytes, lines, mode, (cache == "" ? "warm" : cache), jobs, run, wall,
+                               bytes / 1048576 / wall, lines / wall,
+                               read_time, pipe, child_read, parse, format, write_time
+                    }' "$stats_file"
+            done
+        done
+    done
+done
@@ -0,0 +1,49 @@
+#!/bin/bash
+# Быстрый разбор чисел в child должен давать те же суммы, что и strtof (-s).
+#
+# Каждое число — отдельная строка, вывод -f shortest однозначно задаёт
+# float, так что расхождение в последнем бите заметно. Кроме случайных
+# чисел проверяются границы быстрого пути и середины между float.
+#
+# usage: check_parse.sh [путь_к_child]
+
+set -euo pipefail
+
+child=${1:-./child}
+[ -x "$child" ] || { echo "error: no $child" >&2; exit 1; }
+
+input=$(mktemp)
+trap 'rm -f "$input"' EXIT
+
+cat > "$input" <<'NUMBERS'
+8.000000476837159
+-8.000000476837159
+16777216
+16777217
+16777218
+0.1
+1e10
+1e-10
+1e11
+3.4028235e38
+1.17549435e-38
+0.000000001
+123456.789
+NUMBERS
+awk 'BEGIN {
+    srand(2024)
+    for (i = 0; i < 20000; i++) {
+        digits = 1 + int(rand() * 17)
+        mantissa = ""
+        for (d = 0; d < digits; d++) mantissa = mantissa int(rand() * 10)
+        point = int(rand() * (digits + 1))
+        printf "%s%s.%s\n", (rand() < 0.5 ? "-" : ""), substr(mantissa, 1, point), substr(mantissa, point + 1)
+    }
+}' >> "$input"
+
+if ! cmp -s <("$child" -f shortest < "$input") <("$child" -s -f shortest < "$input"); then
+    echo "fast parser differs from strtof:" >&2
+    diff <("$child" -f shortest < "$input") <("$child" -s -f shortest < "$input") | head -20 >&2
+    exit 1
+fi
+echo "ok: $(wc -l < "$input") numbers"
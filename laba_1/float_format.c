@@ -0,0 +1,371 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include "float_format.h"
+
+#define FIXED_MAX_PRECISION 9
+#define SHORTEST_MAX_DIGITS 9
+#define EXACT_MAX_EXPONENT 22
+
+static const uint32_t fixed_scales[FIXED_MAX_PRECISION + 1] = {
+    1u, 10u, 100u, 1000u, 10000u, 100000u, 1000000u, 10000000u, 100000000u, 1000000000u,
+};
+
+static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+    1e20, 1e21, 1e22, 1e23, 1e24, 1e25, 1e26, 1e27, 1e28, 1e29,
+    1e30, 1e31, 1e32, 1e33, 1e34, 1e35, 1e36, 1e37, 1e38, 1e39,
+    1e40, 1e41, 1e42, 1e43, 1e44, 1e45, 1e46, 1e47, 1e48, 1e49,
+    1e50, 1e51, 1e52, 1e53, 1e54, 1e55, 1e56, 1e57, 1e58, 1e59,
+};
+
+static int32_t copy_literal(char* str, const char* literal)
+{
+    int32_t len = (int32_t)strlen(literal);
+    memcpy(str, literal, len + 1);
+    return len;
+}
+
+static int32_t format_special(float num, char* str)
+{
+    if (isnan(num))
+    {
+        return copy_literal(str, "nan");
+    }
+    return copy_literal(str, num > 0 ? "inf" : "-inf");
+}
+
+static int32_t write_u64(char* str, uint64_t value)
+{
+    char digits[20];
+    int32_t pos = sizeof(digits);
+    do
+    {
+        digits[--pos] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    memcpy(str, digits + pos, sizeof(digits) - pos);
+    return (int32_t)sizeof(digits) - pos;
+}
+
+static void write_padded(char* str, uint64_t value, int32_t width)
+{
+    for (int32_t i = width - 1; i >= 0; --i)
+    {
+        str[i] = (char)('0' + value % 10);
+        value /= 10;
+    }
+}
+
+#ifdef __SIZEOF_INT128__
+static int32_t write_u128(char* str, unsigned __int128 value)
+{
+    const uint64_t chunk = UINT64_C(10000000000000000000);
+    if (value <= UINT64_MAX)
+    {
+        return write_u64(str, (uint64_t)value);
+    }
+
+    uint64_t low = (uint64_t)(value % chunk);
+    int32_t len = write_u128(str, value / chunk);
+    write_padded(str + len, low, 19);
+    return len + 19;
+}
+#endif
+
+// float — это m * 2^e с целым m < 2^24. При e >= 0 число целое (не больше
+// 2^128), при e < 0 значение num * 10^precision = m * 10^precision / 2^-e
+// округляется к ближайшему, половина — к чётному, как в glibc.
+int32_t float_to_string(float num, char* str, int precision)
+{
+    if (isnan(num) || isinf(num))
+    {
+        return format_special(num, str);
+    }
+
+    uint32_t bits;
+    memcpy(&bits, &num, sizeof(bits));
+    uint32_t biased = (bits >> 23) & 0xFFu;
+    uint64_t mantissa = bits & 0x7FFFFFu;
+    int32_t exponent = -149;
+    if (biased != 0)
+    {
+        mantissa |= UINT64_C(1) << 23;
+        exponent = (int32_t)biased - 150;
+    }
+
+#ifdef __SIZEOF_INT128__
+    bool exact = precision >= 0 && precision <= FIXED_MAX_PRECISION;
+#else
+    bool exact = precision >= 0 && precision <= FIXED_MAX_PRECISION && exponent <= 40;
+#endif
+    if (!exact)
+    {
+        return snprintf(str, FLOAT_FORMAT_MAX_LENGTH, "%.*f", precision, num);
+    }
+
+    char* p = str;
+    if (bits >> 31)
+    {
+        *p++ = '-';
+    }
+
+    uint32_t scale = fixed_scales[precision];
+    uint64_t fraction = 0;
+
+    if (exponent >= 0)
+    {
+#ifdef __SIZEOF_INT128__
+        p += write_u128(p, (unsigned __int128)mantissa << exponent);
+#else
+        p += write_u64(p, mantissa << exponent);
+#endif
+    }
+    else
+    {
+        int32_t shift = -exponent;
+        uint64_t scaled = mantissa * scale;
+        uint64_t rounded = 0;
+        if (shift < 64)
+        {
+            uint64_t half = UINT64_C(1) << (shift - 1);
+            uint64_t remainder = scaled & ((half << 1) - 1);
+            rounded = scaled >> shift;
+            if (remainder > half || (remainder == half && (rounded & 1)))
+            {
+                ++rounded;
+            }
+        }
+        p += write_u64(p, rounded / scale);
+        fraction = rounded % scale;
+    }
+
+    if (precision > 0)
+    {
+        *p++ = '.';
+        write_padded(p, fraction, precision);
+        p += precision;
+    }
+
+    *p = '\0';
+    return (int32_t)(p - str);
+}
+
+static double power_of_ten(int32_t exponent)
+{
+    return exponent >= 0 ? powers_of_ten[exponent] : 1.0 / powers_of_ten[-exponent];
+}
+
+// Интервал округления положительного num: все вещественные числа из
+// (low, high) преобразуются обратно в num. Границы — полусуммы с соседними
+// float, они точно представимы в double.
+typedef struct
+{
+    float num;
+    double low;
+    double high;
+} rounding_interval_t;
+
+static rounding_interval_t rounding_interval(float num)
+{
+    double below = nextafterf(num, 0.0f);
+    rounding_interval_t interval = {num, ((double)num + below) / 2, (double)num + ((double)num - below) / 2};
+    if (num != FLT_MAX)
+    {
+        interval.high = ((double)num + (double)nextafterf(num, INFINITY)) / 2;
+    }
+    return interval;
+}
+
+// Проверяет, что digits * 10^exponent округляется ровно в num. Для малых
+// порядков это одно точное умножение/деление в double. Иначе приближённое
+// значение сравнивается с границами интервала; к strtof приходится
+// обращаться, только если оно попало в зону погрешности у границы.
+static bool decimal_round_trips(uint64_t digits, int32_t exponent, const rounding_interval_t* interval)
+{
+    double value = (double)digits;
+    value = exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+
+    if (digits < (UINT64_C(1) << 53) && exponent >= -EXACT_MAX_EXPONENT && exponent <= EXACT_MAX_EXPONENT)
+    {
+        return (float)value == interval->num;
+    }
+
+    double tolerance = value * 1e-14;
+    if (value < interval->low - tolerance || value > interval->high + tolerance)
+    {
+        return false;
+    }
+    if (value > interval->low + tolerance && value < interval->high - tolerance)
+    {
+        return true;
+    }
+
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%llue%d", (unsigned long long)digits, exponent);
+    return strtof(buf, NULL) == interval->num;
+}
+
+// Ищет n-значное десятичное число digits * 10^exponent, округляющееся в num:
+// достаточно проверить двух ближайших соседей снизу и сверху.
+static bool shortest_candidate(const rounding_interval_t* interval, int32_t magnitude, int32_t n,
+                               uint64_t* digits, int32_t* exponent)
+{
+    double value = interval->num;
+    *exponent = magnitude - n + 1;
+    double scaled = *exponent >= 0 ? value / powers_of_ten[*exponent] : value * powers_of_ten[-*exponent];
+    uint64_t below = (uint64_t)scaled;
+    uint64_t above = below + 1;
+
+    uint64_t nearest = scaled - (double)below <= (double)above - scaled ? below : above;
+    uint64_t other = nearest == below ? above : below;
+
+    if (nearest != 0 && decimal_round_trips(nearest, *exponent, interval))
+    {
+        *digits = nearest;
+        return true;
+    }
+    if (other != 0 && decimal_round_trips(other, *exponent, interval))
+    {
+        *digits = other;
+        return true;
+    }
+    return false;
+}
+
+static int32_t write_shortest(char* str, uint64_t digits, int32_t exponent)
+{
+    while (digits % 10 == 0)
+    {
+        digits /= 10;
+        ++exponent;
+    }
+
+    char text[20];
+    int32_t length = write_u64(text, digits);
+    int32_t point = length + exponent;
+    char* p = str;
+
+    if (point > 0 && point <= 21)
+    {
+        if (point >= length)
+        {
+            memcpy(p, text, length);
+            p += length;
+            memset(p, '0', point - length);
+            p += point - length;
+        }
+        else
+        {
+            memcpy(p, text, point);
+            p += point;
+            *p++ = '.';
+            memcpy(p, text + point, length - point);
+            p += length - point;
+        }
+    }
+    else if (point <= 0 && point > -6)
+    {
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', -point);
+        p += -point;
+        memcpy(p, text, length);
+        p += length;
+    }
+    else
+    {
+        *p++ = text[0];
+        if (length > 1)
+        {
+            *p++ = '.';
+            memcpy(p, text + 1, length - 1);
+            p += length - 1;
+        }
+        *p++ = 'e';
+        int32_t power = point - 1;
+        if (power < 0)
+        {
+            *p++ = '-';
+            power = -power;
+        }
+        p += write_u64(p, (uint64_t)power);
+    }
+
+    *p = '\0';
+    return (int32_t)(p - str);
+}
+
+// Если n-значное число попадает в интервал округления, то и (n+1)-значное
+// тоже, поэтому минимальная длина мантиссы n = 1..9 ищется двоичным
+// поиском. Для float 9 значащих цифр всегда достаточно.
+int32_t float_to_shortest(float num, char* str)
+{
+    if (isnan(num) || isinf(num))
+    {
+        return format_special(num, str);
+    }
+
+    char* p = str;
+    if (signbit(num))
+    {
+        *p++ = '-';
+        num = -num;
+    }
+    if (num == 0.0f)
+    {
+        *p++ = '0';
+        *p = '\0';
+        return (int32_t)(p - str);
+    }
+
+    // Десятичный порядок оценивается по двоичному (log10(2) ~ 0.30103)
+    // и уточняется сравнением со степенями десяти.
+    int binary_exponent;
+    frexpf(num, &binary_exponent);
+    int32_t magnitude = (int32_t)floor((binary_exponent - 1) * 0.30102999566398120);
+    while (num >= power_of_ten(magnitude + 1))
+    {
+        ++magnitude;
+    }
+    while (num < power_of_ten(magnitude))
+    {
+        --magnitude;
+    }
+
+    rounding_interval_t interval = rounding_interval(num);
+    uint64_t digits = 0;
+    int32_t exponent = 0;
+    if (!shortest_candidate(&interval, magnitude, SHORTEST_MAX_DIGITS, &digits, &exponent))
+    {
+        return (int32_t)(p - str) + snprintf(p, FLOAT_FORMAT_MAX_LENGTH - (p - str), "%.9g", num);
+    }
+
+    int32_t low = 1;
+    int32_t high = SHORTEST_MAX_DIGITS;
+    while (low < high)
+    {
+        int32_t n = (low + high) / 2;
+        uint64_t candidate;
+        int32_t candidate_exponent;
+        if (shortest_candidate(&interval, magnitude, n, &candidate, &candidate_exponent))
+        {
+            high = n;
+            digits = candidate;
+            exponent = candidate_exponent;
+        }
+        else
+        {
+            low = n + 1;
+        }
+    }
+
+    return (int32_t)(p - str) + write_shortest(p, digits, exponent);
+}
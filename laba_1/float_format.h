@@ -0,0 +1,16 @@
+#ifndef FLOAT_FORMAT_H
+#define FLOAT_FORMAT_H
+
+#include <stdint.h>
+
+#define FLOAT_FORMAT_MAX_LENGTH 64
+
+// То же, что snprintf("%.*f", precision, num), но без разбора формата;
+// для precision от 0 до 9 округление выполняется точно в целых числах.
+int32_t float_to_string(float num, char* str, int precision);
+
+// Кратчайшая десятичная запись, из которой strtof восстанавливает
+// ровно то же число.
+int32_t float_to_shortest(float num, char* str);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef FRAME_FORMAT_H
+#define FRAME_FORMAT_H
+
+#include <stdint.h>
+
+#include "result_format.h"
+
+// Кадры от родителя к ребёнку в пакетном режиме (child -F), little-endian.
+// Через один pipe идёт несколько файлов подряд, каждый — как
+// FRAME_FILE_BEGIN, любое число FRAME_FILE_DATA и FRAME_FILE_END.
+//
+// Заголовок кадра, 8 байт:
+//   0      тип кадра
+//   1..3   нули
+//   4..7   длина данных кадра
+//
+// Данные FRAME_FILE_BEGIN: 4 байта номера файла в списке, затем имя
+// (не длиннее FRAME_NAME_MAX). FRAME_FILE_DATA — очередной кусок
+// содержимого. У FRAME_FILE_END данных нет.
+
+#define FRAME_HEADER_SIZE 8
+#define FRAME_NAME_MAX RESULT_NAME_MAX
+#define FRAME_FILE_BEGIN 'B'
+#define FRAME_FILE_DATA 'D'
+#define FRAME_FILE_END 'E'
+
+static inline void frame_encode_header(uint8_t* dst, uint8_t type, uint32_t length)
+{
+    dst[0] = type;
+    dst[1] = dst[2] = dst[3] = 0;
+    result_store_le(dst + 4, length, 4);
+}
+
+static inline void frame_decode_header(const uint8_t* src, uint8_t* type, uint32_t* length)
+{
+    *type = src[0];
+    *length = (uint32_t)result_load_le(src + 4, 4);
+}
+
+#endif
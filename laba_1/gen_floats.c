@@ -0,0 +1,300 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <getopt.h>
+
+#define OUTPUT_BUFFER_SIZE (1024 * 1024)
+#define NUMBER_MAX_LENGTH 48
+#define MAX_PRECISION 9
+
+// Генератор входных файлов для Child.c: строки из чисел через пробел,
+// вперемешку обычная запись ("-12.345") и экспоненциальная ("1.5e-3").
+// Одинаковые параметры и seed дают байт в байт одинаковый файл.
+
+typedef enum
+{
+    LENGTH_FIXED,
+    LENGTH_UNIFORM,
+    LENGTH_GEOMETRIC
+} length_distribution_t;
+
+typedef struct
+{
+    uint64_t lines;
+    uint64_t bytes;
+    int32_t min_numbers;
+    int32_t max_numbers;
+    double exponent_share;
+    length_distribution_t distribution;
+    int32_t precision;
+    uint64_t seed;
+    const char* output;
+} generator_options_t;
+
+static char output[OUTPUT_BUFFER_SIZE];
+static size_t output_length;
+static int32_t output_fd = STDOUT_FILENO;
+
+static uint64_t next_random(uint64_t* state)
+{
+    uint64_t z = (*state += UINT64_C(0x9E3779B97F4A7C15));
+    z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+}
+
+static double next_unit(uint64_t* state)
+{
+    return (double)(next_random(state) >> 11) / (double)(UINT64_C(1) << 53);
+}
+
+static uint64_t next_below(uint64_t* state, uint64_t bound)
+{
+    return bound == 0 ? 0 : next_random(state) % bound;
+}
+
+static void flush_output(void)
+{
+    const char* data = output;
+    while (output_length > 0)
+    {
+        ssize_t written = write(output_fd, data, output_length);
+        if (written < 0)
+        {
+            const char msg[] = "error: failed to write output\n";
+            write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            exit(EXIT_FAILURE);
+        }
+        data += written;
+        output_length -= written;
+    }
+}
+
+// Количество чисел в строке. Геометрическое распределение со средним
+// посередине диапазона даёт много коротких строк и редкие длинные.
+static int32_t numbers_in_line(const generator_options_t* options, uint64_t* state)
+{
+    int32_t span = options->max_numbers - options->min_numbers;
+    switch (options->distribution)
+    {
+    case LENGTH_UNIFORM:
+        return options->min_numbers + (int32_t)next_below(state, (uint64_t)span + 1);
+    case LENGTH_GEOMETRIC:
+        {
+            double stop = 1.0 / (1.0 + span / 2.0);
+            int32_t count = options->min_numbers;
+            while (count < options->max_numbers && next_unit(state) >= stop)
+            {
+                ++count;
+            }
+            return count;
+        }
+    default:
+        return options->max_numbers;
+    }
+}
+
+static int32_t write_digits(char* str, uint64_t value, int32_t width)
+{
+    char digits[20];
+    int32_t pos = sizeof(digits);
+    do
+    {
+        digits[--pos] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0 || (int32_t)sizeof(digits) - pos < width);
+
+    memcpy(str, digits + pos, sizeof(digits) - pos);
+    return (int32_t)sizeof(digits) - pos;
+}
+
+// Обычная запись: до 6 цифр целой части и precision знаков после точки.
+// Экспоненциальная: мантисса d.ddd и порядок от -30 до 30.
+static int32_t write_number(const generator_options_t* options, uint64_t* state, char* str)
+{
+    char* p = str;
+    uint64_t r = next_random(state);
+    if (r & 1)
+    {
+        *p++ = '-';
+    }
+
+    if (next_unit(state) < options->exponent_share)
+    {
+        p += write_digits(p, 1 + next_below(state, 9), 1);
+        *p++ = '.';
+        p += write_digits(p, next_below(state, 1000), 3);
+        *p++ = 'e';
+        int32_t exponent = (int32_t)next_below(state, 61) - 30;
+        if (exponent < 0)
+        {
+            *p++ = '-';
+            exponent = -exponent;
+        }
+        p += write_digits(p, (uint64_t)exponent, 1);
+        return (int32_t)(p - str);
+    }
+
+    static const uint64_t limits[] = {10, 100, 1000, 10000, 100000, 1000000};
+    p += write_digits(p, next_below(state, limits[(r >> 1) % 6]), 1);
+    if (options->precision > 0)
+    {
+        uint64_t scale = 1;
+        for (int32_t i = 0; i < options->precision; ++i)
+        {
+            scale *= 10;
+        }
+        *p++ = '.';
+        p += write_digits(p, next_below(state, scale), options->precision);
+    }
+    return (int32_t)(p - str);
+}
+
+static void print_usage_and_exit(void)
+{
+    const char msg[] =
+        "usage: gen_floats (-n lines | -S bytes) [-k min[-max]] [-e exponent_share]\n"
+        "                  [-d fixed|uniform|geometric] [-p precision] [-r seed] [-o file]\n";
+    write(STDERR_FILENO, msg, sizeof(msg) - 1);
+    exit(EXIT_FAILURE);
+}
+
+static void parse_options(int argc, char* argv[], generator_options_t* options)
+{
+    *options = (generator_options_t){
+        .min_numbers = 1,
+        .max_numbers = 16,
+        .exponent_share = 0.1,
+        .distribution = LENGTH_UNIFORM,
+        .precision = 3,
+        .seed = 42,
+    };
+
+    int opt;
+    char* end;
+    while ((opt = getopt(argc, argv, "n:S:k:e:d:p:r:o:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            options->lines = strtoull(optarg, &end, 10);
+            break;
+        case 'S':
+            options->bytes = strtoull(optarg, &end, 10);
+            break;
+        case 'k':
+            options->min_numbers = (int32_t)strtol(optarg, &end, 10);
+            options->max_numbers = options->min_numbers;
+            if (*end == '-')
+            {
+                options->max_numbers = (int32_t)strtol(end + 1, &end, 10);
+            }
+            break;
+        case 'e':
+            options->exponent_share = strtod(optarg, &end);
+            break;
+        case 'd':
+            end = "";
+            if (strcmp(optarg, "fixed") == 0)
+            {
+                options->distribution = LENGTH_FIXED;
+            }
+            else if (strcmp(optarg, "uniform") == 0)
+            {
+                options->distribution = LENGTH_UNIFORM;
+            }
+            else if (strcmp(optarg, "geometric") == 0)
+            {
+                options->distribution = LENGTH_GEOMETRIC;
+            }
+            else
+            {
+                print_usage_and_exit();
+            }
+            break;
+        case 'p':
+            options->precision = (int32_t)strtol(optarg, &end, 10);
+            break;
+        case 'r':
+            options->seed = strtoull(optarg, &end, 10);
+            break;
+        case 'o':
+            end = "";
+            options->output = optarg;
+            break;
+        default:
+            print_usage_and_exit();
+        }
+        if (*end != '\0')
+        {
+            print_usage_and_exit();
+        }
+    }
+
+    if ((options->lines == 0) == (options->bytes == 0) || optind != argc ||
+        options->min_numbers < 1 || options->max_numbers < options->min_numbers ||
+        options->exponent_share < 0.0 || options->exponent_share > 1.0 ||
+        options->precision < 0 || options->precision > MAX_PRECISION)
+    {
+        print_usage_and_exit();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    generator_options_t options;
+    parse_options(argc, argv, &options);
+
+    if (options.output != NULL)
+    {
+        output_fd = open(options.output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (output_fd == -1)
+        {
+            const char msg[] = "error: failed to open output file\n";
+            write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // При -S генерация останавливается на первой строке, после которой
+    // размер достиг заданного: файл всегда заканчивается целой строкой.
+    uint64_t state = options.seed;
+    uint64_t lines = 0;
+    uint64_t bytes = 0;
+    while (options.lines != 0 ? lines < options.lines : bytes < options.bytes)
+    {
+        int32_t count = numbers_in_line(&options, &state);
+        for (int32_t i = 0; i < count; ++i)
+        {
+            if (output_length + NUMBER_MAX_LENGTH > sizeof(output))
+            {
+                flush_output();
+            }
+            size_t before = output_length;
+            if (i > 0)
+            {
+                output[output_length++] = ' ';
+            }
+            output_length += write_number(&options, &state, output + output_length);
+            bytes += output_length - before;
+        }
+        if (output_length + 1 > sizeof(output))
+        {
+            flush_output();
+        }
+        output[output_length++] = '\n';
+        ++bytes;
+        ++lines;
+    }
+
+    flush_output();
+    if (output_fd != STDOUT_FILENO)
+    {
+        close(output_fd);
+    }
+    return EXIT_SUCCESS;
+}
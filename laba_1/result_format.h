@@ -0,0 +1,120 @@
+#ifndef RESULT_FORMAT_H
+#define RESULT_FORMAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Двоичный формат результатов ребёнка (все поля little-endian).
+//
+// Заголовок, 16 байт:
+//   0..3   магия "L1RS"
+//   4..5   версия формата (RESULT_VERSION)
+//   6..7   размер заголовка (RESULT_HEADER_SIZE)
+//   8..9   размер записи (RESULT_RECORD_SIZE)
+//   10..15 зарезервировано, нули
+//
+// Запись на каждую строку, 16 байт:
+//   0..7   номер строки
+//   8..11  количество чисел
+//   12..15 сумма, биты IEEE 754 float
+//
+// Начало секции файла (версия 2, только в пакетном режиме child -F):
+//   0..7   RESULT_SECTION_LINE
+//   8..11  длина имени файла
+//   12..15 номер файла в списке родителя
+//   далее имя файла, дополненное нулями до кратного 16 размера
+
+#define RESULT_MAGIC "L1RS"
+#define RESULT_VERSION 2
+#define RESULT_HEADER_SIZE 16
+#define RESULT_RECORD_SIZE 16
+#define RESULT_SECTION_LINE UINT64_MAX
+#define RESULT_NAME_MAX 4096
+
+typedef struct
+{
+    uint64_t line_number;
+    uint32_t count;
+    float sum;
+} result_record_t;
+
+static inline void result_store_le(uint8_t* dst, uint64_t value, int32_t size)
+{
+    for (int32_t i = 0; i < size; ++i)
+    {
+        dst[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static inline uint64_t result_load_le(const uint8_t* src, int32_t size)
+{
+    uint64_t value = 0;
+    for (int32_t i = size - 1; i >= 0; --i)
+    {
+        value = (value << 8) | src[i];
+    }
+    return value;
+}
+
+static inline void result_encode_header(uint8_t* dst)
+{
+    memset(dst, 0, RESULT_HEADER_SIZE);
+    memcpy(dst, RESULT_MAGIC, 4);
+    result_store_le(dst + 4, RESULT_VERSION, 2);
+    result_store_le(dst + 6, RESULT_HEADER_SIZE, 2);
+    result_store_le(dst + 8, RESULT_RECORD_SIZE, 2);
+}
+
+static inline bool result_check_header(const uint8_t* src)
+{
+    return memcmp(src, RESULT_MAGIC, 4) == 0 &&
+           result_load_le(src + 4, 2) >= 1 && result_load_le(src + 4, 2) <= RESULT_VERSION &&
+           result_load_le(src + 6, 2) == RESULT_HEADER_SIZE &&
+           result_load_le(src + 8, 2) == RESULT_RECORD_SIZE;
+}
+
+static inline void result_encode_record(uint8_t* dst, const result_record_t* record)
+{
+    uint32_t bits;
+    memcpy(&bits, &record->sum, sizeof(bits));
+    result_store_le(dst, record->line_number, 8);
+    result_store_le(dst + 8, record->count, 4);
+    result_store_le(dst + 12, bits, 4);
+}
+
+static inline void result_decode_record(const uint8_t* src, result_record_t* record)
+{
+    uint32_t bits = (uint32_t)result_load_le(src + 12, 4);
+    record->line_number = result_load_le(src, 8);
+    record->count = (uint32_t)result_load_le(src + 8, 4);
+    memcpy(&record->sum, &bits, sizeof(bits));
+}
+
+static inline bool result_is_section(const uint8_t* src)
+{
+    return result_load_le(src, 8) == RESULT_SECTION_LINE;
+}
+
+static inline size_t result_section_size(uint32_t name_length)
+{
+    return RESULT_RECORD_SIZE + (name_length + RESULT_RECORD_SIZE - 1) / RESULT_RECORD_SIZE * RESULT_RECORD_SIZE;
+}
+
+// Пишет всю секцию: dst должен вмещать result_section_size(name_length) байт.
+static inline void result_encode_section(uint8_t* dst, uint32_t index, const char* name, uint32_t name_length)
+{
+    memset(dst, 0, result_section_size(name_length));
+    result_store_le(dst, RESULT_SECTION_LINE, 8);
+    result_store_le(dst + 8, name_length, 4);
+    result_store_le(dst + 12, index, 4);
+    memcpy(dst + RESULT_RECORD_SIZE, name, name_length);
+}
+
+static inline void result_decode_section(const uint8_t* src, uint32_t* index, uint32_t* name_length)
+{
+    *name_length = (uint32_t)result_load_le(src + 8, 4);
+    *index = (uint32_t)result_load_le(src + 12, 4);
+}
+
+#endif
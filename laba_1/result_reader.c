@@ -0,0 +1,162 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include "float_format.h"
+#include "result_format.h"
+
+#define READ_BUFFER_SIZE (64 * 1024)
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+#define OUTPUT_LINE_MAX 256
+
+// Переводит двоичный вывод "child -B" / "parent -B" обратно в текст
+// "Line N: Sum of C numbers: S", байт в байт как текстовый режим ребёнка.
+// Секции пакетного режима печатаются как "File: имя".
+
+static char output[OUTPUT_BUFFER_SIZE + RESULT_NAME_MAX + OUTPUT_LINE_MAX];
+static size_t output_length;
+
+static bool flush_output(void)
+{
+    const char* data = output;
+    while (output_length > 0)
+    {
+        ssize_t written = write(STDOUT_FILENO, data, output_length);
+        if (written < 0)
+        {
+            return false;
+        }
+        data += written;
+        output_length -= written;
+    }
+    return true;
+}
+
+static void print_record(const result_record_t* record, bool shortest)
+{
+    char sum[FLOAT_FORMAT_MAX_LENGTH];
+    if (shortest)
+    {
+        float_to_shortest(record->sum, sum);
+    }
+    else
+    {
+        float_to_string(record->sum, sum, 6);
+    }
+
+    output_length += snprintf(output + output_length, OUTPUT_LINE_MAX,
+                              "Line %llu: Sum of %u numbers: %s\n",
+                              (unsigned long long)record->line_number, record->count, sum);
+}
+
+int main(int argc, char* argv[])
+{
+    bool shortest = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:")) != -1)
+    {
+        if (opt == 'f' && strcmp(optarg, "shortest") == 0)
+        {
+            shortest = true;
+        }
+        else if (opt != 'f' || strcmp(optarg, "fixed") != 0)
+        {
+            const char msg[] = "usage: result_reader [-f fixed|shortest] [file]\n";
+            write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            return EXIT_FAILURE;
+        }
+    }
+
+    int32_t input = STDIN_FILENO;
+    if (optind < argc)
+    {
+        input = open(argv[optind], O_RDONLY);
+        if (input == -1)
+        {
+            const char msg[] = "error: failed to open file\n";
+            write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            return EXIT_FAILURE;
+        }
+    }
+
+    static uint8_t buffer[READ_BUFFER_SIZE];
+    size_t length = 0;
+    bool header_done = false;
+    ssize_t bytes;
+
+    while ((bytes = read(input, buffer + length, sizeof(buffer) - length)) > 0)
+    {
+        length += bytes;
+        size_t start = 0;
+
+        if (!header_done && length >= RESULT_HEADER_SIZE)
+        {
+            if (!result_check_header(buffer))
+            {
+                const char msg[] = "error: not a result file or unsupported version\n";
+                write(STDERR_FILENO, msg, sizeof(msg) - 1);
+                return EXIT_FAILURE;
+            }
+            header_done = true;
+            start = RESULT_HEADER_SIZE;
+        }
+
+        while (header_done && length - start >= RESULT_RECORD_SIZE)
+        {
+            if (result_is_section(buffer + start))
+            {
+                uint32_t index;
+                uint32_t name_length;
+                result_decode_section(buffer + start, &index, &name_length);
+                if (name_length > RESULT_NAME_MAX)
+                {
+                    const char msg[] = "error: invalid file section in result stream\n";
+                    write(STDERR_FILENO, msg, sizeof(msg) - 1);
+                    return EXIT_FAILURE;
+                }
+                size_t size = result_section_size(name_length);
+                if (length - start < size)
+                {
+                    break;
+                }
+                memcpy(output + output_length, "File: ", 6);
+                memcpy(output + output_length + 6, buffer + start + RESULT_RECORD_SIZE, name_length);
+                output_length += 6 + name_length;
+                output[output_length++] = '\n';
+                start += size;
+            }
+            else
+            {
+                result_record_t record;
+                result_decode_record(buffer + start, &record);
+                print_record(&record, shortest);
+                start += RESULT_RECORD_SIZE;
+            }
+            if (output_length >= OUTPUT_BUFFER_SIZE && !flush_output())
+            {
+                return EXIT_FAILURE;
+            }
+        }
+
+        memmove(buffer, buffer + start, length - start);
+        length -= start;
+    }
+
+    if (!flush_output())
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (bytes < 0 || length != 0)
+    {
+        const char msg[] = "error: truncated or unreadable result stream\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
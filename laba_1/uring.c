@@ -0,0 +1,152 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+
+static void* map_ring(int32_t fd, size_t size, off_t offset)
+{
+    return mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+}
+
+int32_t uring_init(uring_t* ring, uint32_t entries)
+{
+    memset(ring, 0, sizeof(*ring));
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int32_t)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0)
+    {
+        return -1;
+    }
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cq_ring_size > ring->sq_ring_size)
+        {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = map_ring(ring->fd, ring->sq_ring_size, IORING_OFF_SQ_RING);
+    ring->cq_ring = ring->sq_ring;
+    if (ring->sq_ring != MAP_FAILED && !(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        ring->cq_ring = map_ring(ring->fd, ring->cq_ring_size, IORING_OFF_CQ_RING);
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = map_ring(ring->fd, ring->sqes_size, IORING_OFF_SQES);
+
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED)
+    {
+        int saved = errno;
+        uring_close(ring);
+        errno = saved;
+        return -1;
+    }
+
+    char* sq = ring->sq_ring;
+    ring->sq_head = (uint32_t*)(sq + params.sq_off.head);
+    ring->sq_tail = (uint32_t*)(sq + params.sq_off.tail);
+    ring->sq_mask = *(uint32_t*)(sq + params.sq_off.ring_mask);
+    ring->sq_entries = *(uint32_t*)(sq + params.sq_off.ring_entries);
+    ring->sq_array = (uint32_t*)(sq + params.sq_off.array);
+
+    char* cq = ring->cq_ring;
+    ring->cq_head = (uint32_t*)(cq + params.cq_off.head);
+    ring->cq_tail = (uint32_t*)(cq + params.cq_off.tail);
+    ring->cq_mask = *(uint32_t*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+void uring_close(uring_t* ring)
+{
+    if (ring->sqes != NULL && ring->sqes != MAP_FAILED)
+    {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring != NULL && ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring)
+    {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring != NULL && ring->sq_ring != MAP_FAILED)
+    {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    if (ring->fd >= 0)
+    {
+        close(ring->fd);
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+int32_t uring_register_buffers(uring_t* ring, const struct iovec* buffers, uint32_t count)
+{
+    return (int32_t)syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, buffers, count);
+}
+
+// Хвост SQ пишет только этот поток, голову двигает ядро: её читаем
+// с acquire, новый хвост публикуем с release.
+struct io_uring_sqe* uring_get_sqe(uring_t* ring)
+{
+    uint32_t head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = *ring->sq_tail + ring->pending;
+    if (tail - head >= ring->sq_entries)
+    {
+        return NULL;
+    }
+
+    uint32_t index = tail & ring->sq_mask;
+    ring->sq_array[index] = index;
+    ++ring->pending;
+
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int32_t uring_submit_and_wait(uring_t* ring, uint32_t wait)
+{
+    __atomic_store_n(ring->sq_tail, *ring->sq_tail + ring->pending, __ATOMIC_RELEASE);
+    uint32_t submit = ring->pending;
+    ring->pending = 0;
+
+    for (;;)
+    {
+        long result = syscall(__NR_io_uring_enter, ring->fd, submit, wait,
+                              wait > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (result >= 0)
+        {
+            return 0;
+        }
+        if (errno != EINTR)
+        {
+            return -1;
+        }
+        // Прерванный вызов мог не успеть подать SQE: подаём то, что
+        // ядро ещё не забрало.
+        submit = *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    }
+}
+
+bool uring_pop_cqe(uring_t* ring, struct io_uring_cqe* cqe)
+{
+    uint32_t head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+    {
+        return false;
+    }
+    *cqe = ring->cqes[head & ring->cq_mask];
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
@@ -0,0 +1,52 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+// Минимальная обёртка над io_uring на системных вызовах, без liburing:
+// одно кольцо, один поток, подача SQE и разбор CQE.
+typedef struct
+{
+    int32_t fd;
+    uint32_t pending;
+
+    uint32_t* sq_head;
+    uint32_t* sq_tail;
+    uint32_t sq_mask;
+    uint32_t sq_entries;
+    uint32_t* sq_array;
+    struct io_uring_sqe* sqes;
+
+    uint32_t* cq_head;
+    uint32_t* cq_tail;
+    uint32_t cq_mask;
+    struct io_uring_cqe* cqes;
+
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+} uring_t;
+
+// 0 — кольцо создано; -1 — io_uring недоступен (errno как у io_uring_setup).
+int32_t uring_init(uring_t* ring, uint32_t entries);
+
+void uring_close(uring_t* ring);
+
+int32_t uring_register_buffers(uring_t* ring, const struct iovec* buffers, uint32_t count);
+
+// Следующий свободный SQE, обнулённый; NULL, если очередь заполнена.
+struct io_uring_sqe* uring_get_sqe(uring_t* ring);
+
+// Подаёт заполненные SQE и ждёт не меньше wait завершений.
+int32_t uring_submit_and_wait(uring_t* ring, uint32_t wait);
+
+// Забирает одно завершение, если оно есть.
+bool uring_pop_cqe(uring_t* ring, struct io_uring_cqe* cqe);
+
+#endif
@@ -0,0 +1,79 @@
+#!/bin/bash
+# Статическое распределение точек против кусков (--chunk) в kmeans.
+#
+# Один раз пишет файл случайных точек (--write-points), затем для каждого
+# размера куска (0 — отрезки поровну) и числа потоков несколько раз
+# запускает kmeans --points файл --chunk N --quiet K потоки и пишет по
+# строке CSV на каждый поток каждого запуска: время итераций всего
+# запуска и нагрузку потока — точки, долю и время в назначении.
+# Размер куска в CSV — после округления программой.
+#
+# usage: bench_chunk.sh [-b kmeans] [-c "0 256 4096"] [-t "2 4 8"] [-a lloyd] [-r repeats]
+#                       [-P] [-o results.csv] <число_точек> <K>
+
+set -euo pipefail
+
+binary=./kmeans
+chunks="0 256 4096"
+threads_list="2 4 8"
+algorithm=lloyd
+repeats=3
+pin=""
+output=-
+
+usage() {
+    echo "usage: $0 [-b kmeans] [-c \"0 256 4096\"] [-t \"2 4 8\"] [-a lloyd] [-r repeats] [-P] [-o results.csv] points k" >&2
+    exit 1
+}
+
+while getopts "b:c:t:a:r:Po:" opt; do
+    case $opt in
+        b) binary=$OPTARG ;;
+        c) chunks=$OPTARG ;;
+        t) threads_list=$OPTARG ;;
+        a) algorithm=$OPTARG ;;
+        r) repeats=$OPTARG ;;
+        P) pin="--pin" ;;
+        o) output=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+shift $((OPTIND - 1))
+[ $# -eq 2 ] || usage
+[ -x "$binary" ] || { echo "error: no $binary" >&2; exit 1; }
+
+points_file=$(mktemp)
+trap 'rm -f "$points_file"' EXIT
+"$binary" --write-points "$points_file" "$1"
+
+if [ "$output" != - ]; then
+    exec > "$output"
+fi
+
+echo "chunk,threads,algo,points,k,run,iterations,iterations_s,thread,thread_points,share,busy_s"
+
+for chunk in $chunks; do
+    for threads in $threads_list; do
+        for run in $(seq 1 "$repeats"); do
+            # "Нагрузка потоков (куски по N точек):" и
+            # "Поток  T: точек P (S%), назначение B с"
+            "$binary" --points "$points_file" --algo "$algorithm" --chunk "$chunk" $pin --quiet "$2" "$threads" |
+                awk -v threads="$threads" -v algo="$algorithm" -v points="$1" -v k="$2" -v run="$run" '
+                /^Количество итераций:/ { iterations = $3 }
+                /^Время:/ { iterations_s = $7 }
+                /^Нагрузка потоков/ { chunk = ($3 == "(куски") ? $5 : 0 }
+                /^Поток / {
+                    thread = $2; sub(":", "", thread)
+                    share = $5; gsub("[(%),]", "", share)
+                    rows[thread] = sprintf("%d,%.1f,%.6f", $4, share, $7)
+                    count++
+                }
+                END {
+                    for (t = 0; t < count; t++) {
+                        printf "%d,%d,%s,%d,%d,%d,%d,%.6f,%d,%s\n", chunk, threads, algo, points, k, run,
+                               iterations, iterations_s, t, rows[t]
+                    }
+                }'
+        done
+    done
+done
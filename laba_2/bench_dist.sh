@@ -0,0 +1,74 @@
+#!/bin/bash
+# Стоимость обмена в kmeans --processes в зависимости от K.
+#
+# Один раз пишет файл случайных точек (--write-points), затем для каждого
+# способа обмена, числа процессов и K несколько раз запускает
+#   kmeans --points файл --processes --transport T --quiet K процессы
+# и пишет строку CSV на запуск: число итераций, время итераций, из него
+# время обмена и его долю, байты обмена за итерацию и время обмена на
+# одну итерацию.
+#
+# usage: bench_dist.sh [-b kmeans] [-T "shm socket"] [-p "2 4"] [-k "8 64 512 4096"] [-d dim]
+#                      [-r repeats] [-o results.csv] <число_точек>
+
+set -euo pipefail
+
+binary=./kmeans
+transports="shm socket"
+processes_list="2 4"
+k_list="8 64 512 4096"
+dim=2
+repeats=3
+output=-
+
+usage() {
+    echo "usage: $0 [-b kmeans] [-T \"shm socket\"] [-p \"2 4\"] [-k \"8 64 512 4096\"] [-d dim] [-r repeats] [-o results.csv] points" >&2
+    exit 1
+}
+
+while getopts "b:T:p:k:d:r:o:" opt; do
+    case $opt in
+        b) binary=$OPTARG ;;
+        T) transports=$OPTARG ;;
+        p) processes_list=$OPTARG ;;
+        k) k_list=$OPTARG ;;
+        d) dim=$OPTARG ;;
+        r) repeats=$OPTARG ;;
+        o) output=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+shift $((OPTIND - 1))
+[ $# -eq 1 ] || usage
+[ -x "$binary" ] || { echo "error: no $binary" >&2; exit 1; }
+
+points_file=$(mktemp)
+trap 'rm -f "$points_file"' EXIT
+"$binary" --write-points "$points_file" --dim "$dim" "$1"
+
+if [ "$output" != - ]; then
+    exec > "$output"
+fi
+
+echo "transport,processes,points,k,dim,run,iterations,iterations_s,exchange_s,exchange_share,bytes_per_iteration,exchange_per_iteration_s"
+
+for transport in $transports; do
+    for processes in $processes_list; do
+        for k in $k_list; do
+            for run in $(seq 1 "$repeats"); do
+                # "Количество итераций: N" и
+                # "Обмен T: X с из Y с итераций (Z%), байт за итерацию: B"
+                "$binary" --points "$points_file" --processes --transport "$transport" --quiet "$k" "$processes" |
+                    awk -v transport="$transport" -v processes="$processes" -v points="$1" -v k="$k" \
+                        -v dim="$dim" -v run="$run" '
+                    /^Количество итераций:/ { iterations = $3 }
+                    /^Обмен / { exchange_s = $3; iterations_s = $6; share = $9; gsub("[(%),]", "", share); bytes = $NF }
+                    END {
+                        printf "%s,%d,%d,%d,%d,%d,%d,%.6f,%.6f,%.1f,%d,%.6f\n", transport, processes, points, k, dim,
+                               run, iterations, iterations_s, exchange_s, share, bytes,
+                               (iterations > 0 ? exchange_s / iterations : 0)
+                    }'
+            done
+        done
+    done
+done
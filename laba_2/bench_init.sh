@@ -0,0 +1,60 @@
+#!/bin/bash
+# Сравнение способов начального выбора центров kmeans.
+#
+# В каждом запуске пишет файл точек с --seed, равным номеру запуска
+# (--write-points), и на этом же файле прогоняет все --init с тем же
+# --seed, так что способы сравниваются на одних и тех же точках. Пишет
+# строку CSV на способ и запуск: число итераций до сходимости (не больше
+# 100), время инициализации, время итераций и общее время.
+#
+# usage: bench_init.sh [-b kmeans] [-i "first kmeans++ kmeans||"] [-r repeats]
+#                      [-o results.csv] <число_точек> <K> <потоки>
+
+set -euo pipefail
+
+binary=./kmeans
+inits="first kmeans++ kmeans||"
+repeats=5
+output=-
+
+usage() {
+    echo "usage: $0 [-b kmeans] [-i \"first kmeans++ kmeans||\"] [-r repeats] [-o results.csv] points k threads" >&2
+    exit 1
+}
+
+while getopts "b:i:r:o:" opt; do
+    case $opt in
+        b) binary=$OPTARG ;;
+        i) inits=$OPTARG ;;
+        r) repeats=$OPTARG ;;
+        o) output=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+shift $((OPTIND - 1))
+[ $# -eq 3 ] || usage
+[ -x "$binary" ] || { echo "error: no $binary" >&2; exit 1; }
+
+points_file=$(mktemp)
+trap 'rm -f "$points_file"' EXIT
+
+if [ "$output" != - ]; then
+    exec > "$output"
+fi
+
+echo "init,points,k,threads,run,iterations,init_s,iterations_s,total_s"
+
+for run in $(seq 1 "$repeats"); do
+    "$binary" --write-points "$points_file" --seed "$run" "$1"
+    for init in $inits; do
+        # "Количество итераций: N" и "Время: инициализация M X с, итерации Y с"
+        "$binary" --points "$points_file" --init "$init" --seed "$run" --quiet "$2" "$3" | awk -v init="$init" -v points="$1" \
+            -v k="$2" -v threads="$3" -v run="$run" '
+            /^Количество итераций:/ { iterations = $3 }
+            /^Время:/ { init_s = $4; iterations_s = $7 }
+            END {
+                printf "%s,%d,%d,%d,%d,%d,%.6f,%.6f,%.6f\n", init, points, k, threads, run,
+                       iterations, init_s, iterations_s, init_s + iterations_s
+            }'
+    done
+done
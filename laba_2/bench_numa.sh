@@ -0,0 +1,85 @@
+#!/bin/bash
+# Масштабирование kmeans по узлам NUMA.
+#
+# Один раз пишет файл случайных точек (--write-points), затем для каждого
+# числа узлов и потоков несколько раз запускает
+#   kmeans --points файл --pin --nodes N --quiet K потоки
+# и пишет строку CSV на запуск: сколько узлов реально заняли потоки,
+# число итераций, время итераций, время одной итерации и ускорение
+# относительно первой конфигурации (по среднему времени её итераций).
+# По умолчанию узлы — от 1 до числа узлов в /sys/devices/system/node.
+#
+# usage: bench_numa.sh [-b kmeans] [-n "1 2"] [-t "1 2 4 8"] [-d dim] [-r repeats]
+#                      [-o results.csv] <число_точек> <K>
+
+set -euo pipefail
+
+binary=./kmeans
+nodes_list=""
+threads_list="1 2 4 8"
+dim=2
+repeats=3
+output=-
+
+usage() {
+    echo "usage: $0 [-b kmeans] [-n \"1 2\"] [-t \"1 2 4 8\"] [-d dim] [-r repeats] [-o results.csv] points k" >&2
+    exit 1
+}
+
+while getopts "b:n:t:d:r:o:" opt; do
+    case $opt in
+        b) binary=$OPTARG ;;
+        n) nodes_list=$OPTARG ;;
+        t) threads_list=$OPTARG ;;
+        d) dim=$OPTARG ;;
+        r) repeats=$OPTARG ;;
+        o) output=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+shift $((OPTIND - 1))
+[ $# -eq 2 ] || usage
+[ -x "$binary" ] || { echo "error: no $binary" >&2; exit 1; }
+
+if [ -z "$nodes_list" ]; then
+    count=$(ls -d /sys/devices/system/node/node[0-9]* 2> /dev/null | wc -l)
+    nodes_list=$(seq 1 $((count > 0 ? count : 1)))
+fi
+
+points_file=$(mktemp)
+rows_file=$(mktemp)
+trap 'rm -f "$points_file" "$rows_file"' EXIT
+"$binary" --write-points "$points_file" --dim "$dim" "$1"
+
+for nodes in $nodes_list; do
+    for threads in $threads_list; do
+        for run in $(seq 1 "$repeats"); do
+            # "Потоки закреплены, узлов NUMA: U из M, ...", "Количество итераций: N"
+            # и "Время: инициализация first X с, итерации Y с"
+            "$binary" --points "$points_file" --pin --nodes "$nodes" --quiet "$2" "$threads" |
+                awk -v nodes="$nodes" -v threads="$threads" -v points="$1" -v k="$2" -v dim="$dim" -v run="$run" '
+                /^Потоки закреплены/ { used = $5 }
+                /^Количество итераций:/ { iterations = $3 }
+                /^Время:/ { iterations_s = $7 }
+                END {
+                    printf "%d,%d,%d,%d,%d,%d,%d,%d,%.6f,%.6f\n", nodes, used, threads, points, k, dim, run,
+                           iterations, iterations_s, (iterations > 0 ? iterations_s / iterations : 0)
+                }'
+        done
+    done
+done > "$rows_file"
+
+if [ "$output" != - ]; then
+    exec > "$output"
+fi
+
+echo "nodes,used_nodes,threads,points,k,dim,run,iterations,iterations_s,iteration_s,speedup"
+# Базовая конфигурация — первая пара (узлы, потоки)
+awk -F, '
+    NR == FNR {
+        if (FNR == 1) { base_nodes = $1; base_threads = $3 }
+        if ($1 == base_nodes && $3 == base_threads) { base_sum += $10; base_runs++ }
+        next
+    }
+    { printf "%s,%.3f\n", $0, ($10 > 0 ? base_sum / base_runs / $10 : 0) }
+' "$rows_file" "$rows_file"
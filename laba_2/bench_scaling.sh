@@ -0,0 +1,105 @@
+#!/bin/bash
+# Масштабирование kmeans по числу точек, K и потокам.
+#
+# Для каждого числа точек один раз пишет файл точек с фиксированным
+# --seed (--write-points), затем для каждого K и числа потоков делает
+# разогревочные запуски и несколько замеров
+#   kmeans --points файл --algo A --quiet K потоки
+# (--init first, поэтому все запуски одной пары точки/K проходят одни и
+# те же итерации). Пишет строку CSV на конфигурацию: медиану времени
+# одной итерации по замерам, точек в секунду (назначений за итерацию на
+# секунду), ускорение и параллельную эффективность относительно первого
+# числа потоков в списке.
+#
+# usage: bench_scaling.sh [-b kmeans] [-n "100000 1000000"] [-k "8 64"] [-t "1 2 4 8"] [-d dim]
+#                         [-a lloyd] [-w warmups] [-r repeats] [-s seed] [-o results.csv]
+
+set -euo pipefail
+
+binary=./kmeans
+points_list="100000 1000000"
+k_list="8 64"
+threads_list="1 2 4 8"
+dim=2
+algorithm=lloyd
+warmups=1
+repeats=5
+seed=42
+output=-
+
+usage() {
+    echo "usage: $0 [-b kmeans] [-n \"100000 1000000\"] [-k \"8 64\"] [-t \"1 2 4 8\"] [-d dim] [-a lloyd]" \
+         "[-w warmups] [-r repeats] [-s seed] [-o results.csv]" >&2
+    exit 1
+}
+
+while getopts "b:n:k:t:d:a:w:r:s:o:" opt; do
+    case $opt in
+        b) binary=$OPTARG ;;
+        n) points_list=$OPTARG ;;
+        k) k_list=$OPTARG ;;
+        t) threads_list=$OPTARG ;;
+        d) dim=$OPTARG ;;
+        a) algorithm=$OPTARG ;;
+        w) warmups=$OPTARG ;;
+        r) repeats=$OPTARG ;;
+        s) seed=$OPTARG ;;
+        o) output=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+shift $((OPTIND - 1))
+[ $# -eq 0 ] || usage
+[ -x "$binary" ] || { echo "error: no $binary" >&2; exit 1; }
+[ "$repeats" -gt 0 ] || usage
+
+points_file=$(mktemp)
+trap 'rm -f "$points_file"' EXIT
+
+# Печатает "итерации время_итерации" одного запуска по строкам
+# "Количество итераций: N" и "Время: инициализация first X с, итерации Y с"
+run_once() {
+    "$binary" --points "$points_file" --algo "$algorithm" --quiet "$1" "$2" | awk '
+        /^Количество итераций:/ { iterations = $3 }
+        /^Время:/ { iterations_s = $7 }
+        END { printf "%d %.6f\n", iterations, (iterations > 0 ? iterations_s / iterations : 0) }'
+}
+
+if [ "$output" != - ]; then
+    exec > "$output"
+fi
+
+echo "points,k,threads,dim,algo,repeats,iterations,iteration_s,points_per_s,speedup,efficiency"
+
+for points in $points_list; do
+    "$binary" --write-points "$points_file" --dim "$dim" --seed "$seed" "$points"
+    for k in $k_list; do
+        base_threads=""
+        base_time=""
+        for threads in $threads_list; do
+            for _ in $(seq 1 "$warmups"); do
+                run_once "$k" "$threads" > /dev/null
+            done
+            times=()
+            iterations=0
+            for _ in $(seq 1 "$repeats"); do
+                read -r iterations iteration_s < <(run_once "$k" "$threads")
+                times+=("$iteration_s")
+            done
+            median=$(printf "%s\n" "${times[@]}" | sort -g | awk '
+                { values[NR] = $1 }
+                END { printf "%.6f", (NR % 2 ? values[(NR + 1) / 2] : (values[NR / 2] + values[NR / 2 + 1]) / 2) }')
+            if [ -z "$base_threads" ]; then
+                base_threads=$threads
+                base_time=$median
+            fi
+            awk -v points="$points" -v k="$k" -v threads="$threads" -v dim="$dim" -v algo="$algorithm" \
+                -v repeats="$repeats" -v iterations="$iterations" -v t="$median" \
+                -v base_threads="$base_threads" -v base_t="$base_time" 'BEGIN {
+                speedup = (t > 0 ? base_t / t : 0)
+                printf "%d,%d,%d,%d,%s,%d,%d,%.6f,%.0f,%.3f,%.3f\n", points, k, threads, dim, algo, repeats,
+                       iterations, t, (t > 0 ? points / t : 0), speedup, speedup * base_threads / threads
+            }'
+        done
+    done
+done
@@ -1,188 +1,3232 @@
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <stdatomic.h>
+#include <getopt.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sched.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <limits.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#define KMEANS_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// Все ядра должны округлять сумму квадратов разностей одинаково:
+// FMA-слияние (например, при -march=native) дало бы скалярному пути
+// другой результат.
+#pragma GCC optimize("fp-contract=off")
+
+#define POINT_ALIGNMENT 64
+// Точек в блоке хранения: ровно один регистр AVX-512 или два AVX2
+#define POINT_BLOCK 8
+#define DEFAULT_DIMENSION 2
+// Запас на ошибки округления: центр отсекается, только если он дальше
+// текущего с этим относительным запасом
+#define PRUNE_SLACK 1e-9
+// Пороги --algo auto (см. choose_algorithm)
+#define AUTO_PRUNE_MIN_K 64
+#define AUTO_ELKAN_MIN_DIM 32
+#define AUTO_HAMERLY_MAX_DIM 4
+
+// Двоичный файл точек (--input, --write-points), порядок байт машины:
+//   0..3   магия "KMPT"
+//   4..7   размерность D, uint32
+//   8..15  число точек, uint64
+//   далее точки подряд по D координат (double)
+#define POINTS_MAGIC "KMPT"
+#define POINTS_HEADER_SIZE 16
+#define DEFAULT_BATCH_SIZE 4096
+#define DEFAULT_EPOCHS 3
+
+// Двоичный файл меток (--labels-format binary), порядок байт машины:
+//   0..3   магия "KMLB"
+//   4..7   число кластеров K, uint32
+//   8..15  число точек, uint64
+//   далее номер кластера каждой точки, int32
+#define LABELS_MAGIC "KMLB"
+#define LABELS_HEADER_SIZE 16
+// Метки копятся в буфере и пишутся блоками этого размера
+#define LABELS_BUFFER_SIZE (1 << 20)
+
+#ifndef NUMA_SYSFS
+#define NUMA_SYSFS "/sys/devices/system/node"
+#endif
+
+// Размер куска при --chunk округляется вверх до кратного: тогда куски
+// разных потоков не делят ни блоки точек, ни кэш-линии cluster_id
+#define CHUNK_ALIGNMENT 16
+
+// k-means||: число раундов выборки и сколько кандидатов на раунд
+// ожидается в расчёте на один кластер
+#define SEED_ROUNDS 5
+#define SEED_OVERSAMPLING 2.0
+#define DEFAULT_SEED 42
+
+// Точки хранятся блоками по POINT_BLOCK, внутри блока по столбцам
+// (AoSoA): одна и та же координата восьми соседних точек занимает одну
+// кэш-линию, и SIMD-ядро загружает её одной инструкцией, а весь блок
+// лежит подряд при любом dim (отдельные столбцы на всё множество точек
+// при dim = 128 давали бы 128 разных страниц на каждые 8 точек).
+// Центры, наоборот, хранятся по строкам: центр j — centers[j * dim ...].
+typedef struct {
+    double *coords;
+    int *cluster_id;
+    int count;
+    int dim;
+} PointStore;
+
+// Частичные суммы координат (k x dim, по строкам) и счётчики точек по
+// кластерам, свои у каждого потока. Массивы потока выровнены и дополнены
+// до кэш-линии, чтобы потоки не писали в общие линии.
+typedef struct {
+    double *coords;
+    long *count;
+} ClusterSums;
+
+typedef struct {
+    int thread_id;
+    int start_idx;
+    int end_idx;
+    PointStore *points;
+    double *centers;
+    const double *local_centers;
+    int node;
+    int node_leader;
+    int k;
+    ClusterSums *sums;
+    ClusterSums *thread_sums;
+    int num_threads;
+    int center_start;
+    int center_end;
+    long distances;
+    long assigned_points;
+    double busy_seconds;
+    // Счётчики последнего прохода: главный поток сводит их после итерации
+    long moved;
+    double inertia;
+    double max_shift;
+    double assign_seconds;
+    double reduce_seconds;
+} ThreadArgs;
+
+typedef enum {
+    ALGO_LLOYD,
+    ALGO_HAMERLY,
+    ALGO_ELKAN,
+    // Выбирается по K и размерности (choose_algorithm), когда они известны
+    ALGO_AUTO
+} Algorithm;
+
+// Границы для отсечения по неравенству треугольника.
+// upper[i] — верхняя граница расстояния от точки до её центра.
+// Хамерли: lower[i] — нижняя граница до второго ближайшего центра.
+// Элкан: lower[i * k + j] — нижняя граница до каждого центра j,
+// center_dist — матрица k x k расстояний между центрами.
+// half_gap[j] — половина расстояния от центра j до ближайшего другого:
+// точка, которая ближе этого к своему центру, заведомо остаётся в кластере.
+typedef struct {
+    Algorithm algorithm;
+    double *upper;
+    double *lower;
+    double *center_shift;
+    double *half_gap;
+    double *center_dist;
+    double max_shift;
+    double second_max_shift;
+    int max_shift_id;
+    int first_pass;
+} PruningState;
+
+// Назначает точкам [start, end) ближайший центр и добавляет точку в sums
+// её кластера; возвращает число точек, сменивших кластер.
+// Все варианты сравнивают квадраты расстояний и при равенстве выбирают
+// центр с меньшим номером, поэтому дают одинаковый результат.
+typedef int (*AssignKernel)(PointStore *points, int start, int end, const double *centers, int k,
+                            ClusterSums *sums);
+
+PointStore global_points;
+int total_points = 0;
+int num_threads_max = 0;
+AssignKernel assign_kernel = NULL;
+PruningState pruning = {ALGO_LLOYD};
+
+// Распределение точек при назначении. При chunk_size == 0 у каждого
+// потока один постоянный отрезок [start_idx, end_idx). Иначе потоки
+// берут куски по chunk_size точек из общего курсора, пока точки [0, count)
+// не кончатся, и быстрые потоки успевают взять больше. Суммы потока
+// тогда складываются из разных точек от итерации к итерации, и центры
+// могут отличаться в последних битах от статического распределения.
+typedef struct {
+    int chunk_size;
+    int count;
+    atomic_int cursor;
+} ChunkScheduler;
+
+ChunkScheduler scheduler;
+
+// Инерция считается отдельным проходом, только если её запросили (--stats)
+int collect_inertia = 0;
+
+// Телеметрия одной итерации (--stats). Фазы — по самому медленному потоку:
+// assign — назначение, reduce — сведение сумм в центры плюс расчёт
+// границ центров главным потоком (Хамерли, Элкан), sync — остальное время
+// итерации: ожидание на барьерах и пробуждение потоков.
+typedef struct {
+    int iteration;
+    long moved;
+    double inertia;
+    double max_shift;
+    double wall_seconds;
+    double assign_seconds;
+    double reduce_seconds;
+    double sync_seconds;
+} IterationStats;
+
+typedef enum {
+    STATS_CSV,
+    STATS_JSON
+} StatsFormat;
+
+typedef struct {
+    FILE *file;
+    StatsFormat format;
+    int rows;
+} StatsWriter;
+
+// Как reduce_centers меняет центры: среднее по всем точкам (Ллойд),
+// шаг мини-пакета или никак (проход разметки).
+typedef enum {
+    UPDATE_LLOYD,
+    UPDATE_MINIBATCH,
+    UPDATE_NONE
+} CenterUpdate;
+
+CenterUpdate center_update = UPDATE_LLOYD;
+// Сколько точек каждый центр получил за все пакеты
+long *center_seen = NULL;
+
+typedef enum {
+    INIT_FIRST,
+    INIT_KMEANS_PP,
+    INIT_KMEANS_PARALLEL
+} InitMethod;
+
+// Состояние начального выбора центров (k-means++ и k-means||).
+// min_dist[i] — квадрат расстояния от точки до ближайшего кандидата;
+// кандидаты [applied, candidate_count) ещё не учтены в min_dist.
+// Массивы thread_* — по одному элементу на поток пула.
+typedef struct {
+    uint64_t seed;
+    int round;
+    double *min_dist;
+    double *candidates;
+    int candidate_count;
+    int candidate_capacity;
+    int applied;
+    double oversampling;
+    double total_cost;
+    double *thread_cost;
+    int **thread_picks;
+    int *thread_pick_count;
+    long **thread_weights;
+} SeedingState;
+
+SeedingState seeding;
+
+// Вместо назначения кластеров пул может выполнить над своими отрезками
+// точек произвольную задачу: так начальный выбор центров идёт на тех же
+// потоках.
+typedef void (*PoolTask)(ThreadArgs *args);
+PoolTask pool_task = NULL;
+
+// Точки файла читаются пакетами по capacity штук; в памяти только пакет.
+typedef struct {
+    FILE *file;
+    int dim;
+    long count;
+    long remaining;
+    double *buffer;
+    int capacity;
+} PointReader;
+
+// Размещение потоков по узлам NUMA (--pin). Узлы и их процессоры берутся
+// из sysfs и пересекаются с affinity процесса; без sysfs все разрешённые
+// процессоры — один узел. Потоки делятся между used_nodes узлами
+// подряд, так что точки узла — один непрерывный отрезок. Если узлов
+// больше одного, у каждого своя копия центров (node_centers): её читает
+// назначение, пересчёт пишет в общий centers, а главный поток после
+// итерации копирует его в копии узлов.
+typedef struct {
+    int node_count;
+    int *node_ids;
+    cpu_set_t *node_cpus;
+    int used_nodes;
+    int *thread_cpu;
+    int *thread_node;
+    double **node_centers;
+    double *centers;
+    size_t center_count;
+    const double *rows;
+} NumaState;
+
+NumaState numa;
+
+typedef enum {
+    LABELS_TEXT,
+    LABELS_BINARY
+} LabelFormat;
+
+// Запись меток: текст (по числу на строку) или двоичный KMLB
+typedef struct {
+    FILE *file;
+    LabelFormat format;
+    char *buffer;
+    size_t length;
+    int ok;
+} LabelWriter;
+
+// Несколько процессов вместо потоков (--processes): прототип k-means на
+// нескольких машинах. Рабочий процесс w получает точки при fork и
+// назначает кластеры только своему отрезку [start_idx, end_idx), как
+// поток w; за итерацию он отдаёт координатору частичные суммы и счётчики
+// по кластерам, координатор сводит их в порядке процессов и рассылает
+// новые центры. Обмен — через общий сегмент памяти (shm) или через
+// Unix-сокеты, как по сети (socket).
+// В shm координатор запускает итерацию, увеличивая счётчик фаз, а рабочие
+// отмечаются в счётчике done; оба ждут на futex. Барьер здесь не годится:
+// упавший рабочий оставил бы координатора ждать вечно, а ожидание done
+// раз в WORKER_POLL_NS проверяет waitpid, живы ли рабочие.
+#define WORKER_POLL_NS (100 * 1000 * 1000)
+
+typedef enum {
+    TRANSPORT_SHM,
+    TRANSPORT_SOCKET
+} Transport;
+
+// Отчёт рабочего об итерации, по кэш-линии на процесс
+typedef struct {
+    _Alignas(POINT_ALIGNMENT) long moved;
+    double assign_seconds;
+} WorkerReport;
+
+typedef struct {
+    Transport transport;
+    int processes;
+    int k;
+    int dim;
+    pid_t *pids;
+    // shm: счётчики фаз, центры, отчёты, суммы и метки лежат в сегменте
+    unsigned char *segment;
+    size_t segment_size;
+    atomic_uint *phase;
+    atomic_uint *done;
+    atomic_int *running;
+    int *labels;
+    // socket: концы координатора; отчёты и суммы — его собственные копии
+    int *sockets;
+    double *centers;
+    WorkerReport *reports;
+    ClusterSums *sums;
+    size_t bytes_per_iteration;
+    double exchange_seconds;
+    double loop_seconds;
+} ProcessGroup;
+
+ProcessGroup group;
+
+// Несколько K за один проход по точкам (--sweep). Поток идёт по своему
+// отрезку плитками по tile точек и каждую плитку, пока она в кэше,
+// назначает всем активным моделям: точки читаются из памяти один раз за
+// итерацию на все K. Суммы модели у каждого потока свои и сводятся в
+// порядке потоков, поэтому модель проходит те же итерации, что отдельный
+// запуск с её K. Модель выбывает, когда сошлась или исчерпала итерации.
+#define SWEEP_TILE_BYTES (32 << 10)
+#define SWEEP_MAX_MODELS 256
+
+typedef struct {
+    int k;
+    double *centers;
+    int *labels;
+    ClusterSums *thread_sums;
+    long *thread_moved;
+    double *thread_inertia;
+    int active;
+    int converged;
+    int iterations;
+    double inertia;
+} SweepModel;
+
+typedef struct {
+    SweepModel *models;
+    int count;
+    int tile;
+    int passes;
+} SweepState;
+
+SweepState sweep;
+
+// Потоки создаются один раз. Каждая итерация — два прохода барьера
+// (потоки + главный): первый запускает назначение кластеров, второй
+// означает, что все потоки его закончили и центры пересчитаны. Между
+// ними потоки ждут друг друга на reduce_barrier: суммы можно сводить,
+// только когда назначение закончено везде.
+pthread_barrier_t iteration_barrier;
+pthread_barrier_t reduce_barrier;
+atomic_int pool_running = 1;
+
+void* aligned_array(size_t count, size_t size) {
+    size_t bytes = (count * size + POINT_ALIGNMENT - 1) / POINT_ALIGNMENT * POINT_ALIGNMENT;
+    return aligned_alloc(POINT_ALIGNMENT, bytes > 0 ? bytes : POINT_ALIGNMENT);
+}
+
+int point_store_init(PointStore *points, int n, int dim) {
+    size_t blocks = ((size_t)n + POINT_BLOCK - 1) / POINT_BLOCK;
+    points->count = n;
+    points->dim = dim;
+    points->coords = aligned_array(blocks * dim * POINT_BLOCK, sizeof(double));
+    points->cluster_id = aligned_array(n, sizeof(int));
+    return points->coords && points->cluster_id ? 0 : -1;
+}
+
+void point_store_free(PointStore *points) {
+    free(points->coords);
+    free(points->cluster_id);
+}
+
+// Ядра вызываются с dim-константой (см. KERNEL_DIMS), поэтому вспомогательные
+// функции обязаны встраиваться: иначе цикл по координатам не развернётся.
+#define KMEANS_INLINE static inline __attribute__((always_inline))
+// -O2 сам не разворачивает циклы с постоянным числом шагов полностью
+#define KMEANS_UNROLL _Pragma("GCC unroll 16")
+
+// Координата d точки i — point_base(...)[d * POINT_BLOCK]
+KMEANS_INLINE double *point_base(const PointStore *points, int i, int dim) {
+    return points->coords + (size_t)(i / POINT_BLOCK) * dim * POINT_BLOCK + i % POINT_BLOCK;
+}
+
+static inline double point_coord(const PointStore *points, int i, int d) {
+    return point_base(points, i, points->dim)[d * POINT_BLOCK];
+}
+
+KMEANS_INLINE double squared_distance(const PointStore *points, int i, const double *center, int dim) {
+    const double *point = point_base(points, i, dim);
+    double diff = point[0] - center[0];
+    double dist = diff * diff;
+    KMEANS_UNROLL
+    for (int d = 1; d < dim; d++) {
+        diff = point[d * POINT_BLOCK] - center[d];
+        dist += diff * diff;
+    }
+    return dist;
+}
+
+static inline double center_distance(const double *a, const double *b, int dim) {
+    double dist = 0;
+    for (int d = 0; d < dim; d++) {
+        double diff = a[d] - b[d];
+        dist += diff * diff;
+    }
+    return dist;
+}
+
+KMEANS_INLINE int nearest_center(const PointStore *points, int i, const double *centers, int k, int dim) {
+    double min_dist = squared_distance(points, i, centers, dim);
+    int best_cluster = 0;
+
+    for (int j = 1; j < k; j++) {
+        double dist = squared_distance(points, i, centers + (size_t)j * dim, dim);
+        if (dist < min_dist) {
+            min_dist = dist;
+            best_cluster = j;
+        }
+    }
+    return best_cluster;
+}
+
+// point — начало точки в блоке (point_base), координаты идут с шагом POINT_BLOCK.
+KMEANS_INLINE void add_to_sum(ClusterSums *sums, int cluster_id, const double *point, int dim) {
+    double *sum = sums->coords + (size_t)cluster_id * dim;
+    KMEANS_UNROLL
+    for (int d = 0; d < dim; d++) {
+        sum[d] += point[d * POINT_BLOCK];
+    }
+    sums->count[cluster_id]++;
+}
+
+KMEANS_INLINE int assign_scalar_body(PointStore *points, int start, int end, const double *centers, int k,
+                                     ClusterSums *sums, int dim) {
+    int moved = 0;
+    for (int i = start; i < end; i++) {
+        int best_cluster = nearest_center(points, i, centers, k, dim);
+        add_to_sum(sums, best_cluster, point_base(points, i, dim), dim);
+        if (points->cluster_id[i] != best_cluster) {
+            points->cluster_id[i] = best_cluster;
+            moved++;
+        }
+    }
+    return moved;
+}
+
+#ifdef KMEANS_X86_SIMD
+// SSE2: 4 точки за шаг (два регистра по 2 double) против всех k центров;
+// до границы половины блока точки идут через скалярный путь.
+// Номер лучшего центра хранится как double и переключается маской сравнения.
+// Расстояние копится по координатам в том же порядке, что в squared_distance.
+__attribute__((target("sse2"), always_inline))
+static inline int assign_sse2_body(PointStore *points, int start, int end, const double *centers, int k,
+                                   ClusterSums *sums, int dim) {
+    int i = (start + 3) / 4 * 4 < end ? (start + 3) / 4 * 4 : end;
+    int moved = assign_scalar_body(points, start, i, centers, k, sums, dim);
+    for (; i + 4 <= end; i += 4) {
+        const double *block = point_base(points, i, dim);
+        __m128d best0 = _mm_set1_pd(INFINITY);
+        __m128d best1 = best0;
+        __m128d index0 = _mm_setzero_pd();
+        __m128d index1 = index0;
+
+        for (int j = 0; j < k; j++) {
+            const double *center = centers + (size_t)j * dim;
+            __m128d id = _mm_set1_pd((double)j);
+            __m128d c = _mm_set1_pd(center[0]);
+            __m128d diff0 = _mm_sub_pd(_mm_loadu_pd(block), c);
+            __m128d diff1 = _mm_sub_pd(_mm_loadu_pd(block + 2), c);
+            __m128d dist0 = _mm_mul_pd(diff0, diff0);
+            __m128d dist1 = _mm_mul_pd(diff1, diff1);
+
+            KMEANS_UNROLL
+            for (int d = 1; d < dim; d++) {
+                const double *column = block + d * POINT_BLOCK;
+                c = _mm_set1_pd(center[d]);
+                diff0 = _mm_sub_pd(_mm_loadu_pd(column), c);
+                diff1 = _mm_sub_pd(_mm_loadu_pd(column + 2), c);
+                dist0 = _mm_add_pd(dist0, _mm_mul_pd(diff0, diff0));
+                dist1 = _mm_add_pd(dist1, _mm_mul_pd(diff1, diff1));
+            }
+
+            __m128d less0 = _mm_cmplt_pd(dist0, best0);
+            best0 = _mm_or_pd(_mm_and_pd(less0, dist0), _mm_andnot_pd(less0, best0));
+            index0 = _mm_or_pd(_mm_and_pd(less0, id), _mm_andnot_pd(less0, index0));
+
+            __m128d less1 = _mm_cmplt_pd(dist1, best1);
+            best1 = _mm_or_pd(_mm_and_pd(less1, dist1), _mm_andnot_pd(less1, best1));
+            index1 = _mm_or_pd(_mm_and_pd(less1, id), _mm_andnot_pd(less1, index1));
+        }
+
+        __m128i ids = _mm_unpacklo_epi64(_mm_cvttpd_epi32(index0), _mm_cvttpd_epi32(index1));
+        __m128i old = _mm_loadu_si128((const __m128i*)(points->cluster_id + i));
+        // 4 бита маски на каждую совпавшую метку
+        int same = _mm_movemask_epi8(_mm_cmpeq_epi32(ids, old));
+        if (same != 0xFFFF) {
+            _mm_storeu_si128((__m128i*)(points->cluster_id + i), ids);
+            moved += 4 - __builtin_popcount(same) / 4;
+        }
+        for (int lane = 0; lane < 4; lane++) {
+            add_to_sum(sums, points->cluster_id[i + lane], block + lane, dim);
+        }
+    }
+    return moved + assign_scalar_body(points, i, end, centers, k, sums, dim);
+}
+
+// AVX2: 8 точек за шаг (два регистра по 4 double).
+__attribute__((target("avx2"), always_inline))
+static inline void avx2_keep_nearest(__m256d dist, __m256d id, __m256d *best, __m256d *index) {
+    __m256d less = _mm256_cmp_pd(dist, *best, _CMP_LT_OQ);
+    *best = _mm256_blendv_pd(*best, dist, less);
+    *index = _mm256_blendv_pd(*index, id, less);
+}
+
+// При dim > 4 центры идут парами: загрузки точек общие для двух центров, а
+// четыре независимые цепочки сложений не упираются в задержку vaddpd. При
+// малых dim пары только вытесняют регистры. Сравнение по-прежнему в порядке
+// номеров центров.
+__attribute__((target("avx2"), always_inline))
+static inline int assign_avx2_body(PointStore *points, int start, int end, const double *centers, int k,
+                                   ClusterSums *sums, int dim) {
+    int i = (start + 7) / 8 * 8 < end ? (start + 7) / 8 * 8 : end;
+    int moved = assign_scalar_body(points, start, i, centers, k, sums, dim);
+    for (; i + 8 <= end; i += 8) {
+        const double *block = point_base(points, i, dim);
+        __m256d best0 = _mm256_set1_pd(INFINITY);
+        __m256d best1 = best0;
+        __m256d index0 = _mm256_setzero_pd();
+        __m256d index1 = index0;
+
+        int j = 0;
+        for (; dim > 4 && j + 2 <= k; j += 2) {
+            const double *center_a = centers + (size_t)j * dim;
+            const double *center_b = center_a + dim;
+            __m256d p0 = _mm256_loadu_pd(block);
+            __m256d p1 = _mm256_loadu_pd(block + 4);
+            __m256d ca = _mm256_set1_pd(center_a[0]);
+            __m256d cb = _mm256_set1_pd(center_b[0]);
+            __m256d diff0 = _mm256_sub_pd(p0, ca);
+            __m256d diff1 = _mm256_sub_pd(p1, ca);
+            __m256d diff2 = _mm256_sub_pd(p0, cb);
+            __m256d diff3 = _mm256_sub_pd(p1, cb);
+            __m256d dist0 = _mm256_mul_pd(diff0, diff0);
+            __m256d dist1 = _mm256_mul_pd(diff1, diff1);
+            __m256d dist2 = _mm256_mul_pd(diff2, diff2);
+            __m256d dist3 = _mm256_mul_pd(diff3, diff3);
+
+            KMEANS_UNROLL
+            for (int d = 1; d < dim; d++) {
+                const double *column = block + d * POINT_BLOCK;
+                p0 = _mm256_loadu_pd(column);
+                p1 = _mm256_loadu_pd(column + 4);
+                ca = _mm256_set1_pd(center_a[d]);
+                cb = _mm256_set1_pd(center_b[d]);
+                diff0 = _mm256_sub_pd(p0, ca);
+                diff1 = _mm256_sub_pd(p1, ca);
+                diff2 = _mm256_sub_pd(p0, cb);
+                diff3 = _mm256_sub_pd(p1, cb);
+                dist0 = _mm256_add_pd(dist0, _mm256_mul_pd(diff0, diff0));
+                dist1 = _mm256_add_pd(dist1, _mm256_mul_pd(diff1, diff1));
+                dist2 = _mm256_add_pd(dist2, _mm256_mul_pd(diff2, diff2));
+                dist3 = _mm256_add_pd(dist3, _mm256_mul_pd(diff3, diff3));
+            }
+
+            __m256d id_a = _mm256_set1_pd((double)j);
+            __m256d id_b = _mm256_set1_pd((double)(j + 1));
+            avx2_keep_nearest(dist0, id_a, &best0, &index0);
+            avx2_keep_nearest(dist1, id_a, &best1, &index1);
+            avx2_keep_nearest(dist2, id_b, &best0, &index0);
+            avx2_keep_nearest(dist3, id_b, &best1, &index1);
+        }
+
+        for (; j < k; j++) {
+            const double *center = centers + (size_t)j * dim;
+            __m256d c = _mm256_set1_pd(center[0]);
+            __m256d diff0 = _mm256_sub_pd(_mm256_loadu_pd(block), c);
+            __m256d diff1 = _mm256_sub_pd(_mm256_loadu_pd(block + 4), c);
+            __m256d dist0 = _mm256_mul_pd(diff0, diff0);
+            __m256d dist1 = _mm256_mul_pd(diff1, diff1);
+
+            KMEANS_UNROLL
+            for (int d = 1; d < dim; d++) {
+                const double *column = block + d * POINT_BLOCK;
+                c = _mm256_set1_pd(center[d]);
+                diff0 = _mm256_sub_pd(_mm256_loadu_pd(column), c);
+                diff1 = _mm256_sub_pd(_mm256_loadu_pd(column + 4), c);
+                dist0 = _mm256_add_pd(dist0, _mm256_mul_pd(diff0, diff0));
+                dist1 = _mm256_add_pd(dist1, _mm256_mul_pd(diff1, diff1));
+            }
+
+            __m256d id = _mm256_set1_pd((double)j);
+            avx2_keep_nearest(dist0, id, &best0, &index0);
+            avx2_keep_nearest(dist1, id, &best1, &index1);
+        }
+
+        __m256i ids = _mm256_set_m128i(_mm256_cvttpd_epi32(index1), _mm256_cvttpd_epi32(index0));
+        __m256i old = _mm256_loadu_si256((const __m256i*)(points->cluster_id + i));
+        unsigned int same = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi32(ids, old));
+        if (same != 0xFFFFFFFFu) {
+            _mm256_storeu_si256((__m256i*)(points->cluster_id + i), ids);
+            moved += 8 - __builtin_popcount(same) / 4;
+        }
+        for (int lane = 0; lane < 8; lane++) {
+            add_to_sum(sums, points->cluster_id[i + lane], block + lane, dim);
+        }
+    }
+    return moved + assign_scalar_body(points, i, end, centers, k, sums, dim);
+}
+#endif
+
+// Для частых размерностей ядра генерируются с dim-константой: циклы по
+// координатам разворачиваются, а точки держатся в регистрах между центрами.
+// Остальные размерности идут через ядра _generic с dim из PointStore.
+#define KERNEL_DIMS(X) X(2) X(3) X(4) X(8) X(16) X(32) X(64) X(128)
+
+#define DEFINE_KERNEL(variant, target, suffix, dim)                                                   \
+    target int assign_##variant##_##suffix(PointStore *points, int start, int end,                    \
+                                           const double *centers, int k, ClusterSums *sums) {         \
+        return assign_##variant##_body(points, start, end, centers, k, sums, dim);                    \
+    }
+
+#define DEFINE_SCALAR_KERNEL(D) DEFINE_KERNEL(scalar, , d##D, D)
+KERNEL_DIMS(DEFINE_SCALAR_KERNEL)
+DEFINE_KERNEL(scalar, , generic, points->dim)
+
+#ifdef KMEANS_X86_SIMD
+#define DEFINE_SSE2_KERNEL(D) DEFINE_KERNEL(sse2, __attribute__((target("sse2"))), d##D, D)
+#define DEFINE_AVX2_KERNEL(D) DEFINE_KERNEL(avx2, __attribute__((target("avx2"))), d##D, D)
+KERNEL_DIMS(DEFINE_SSE2_KERNEL)
+KERNEL_DIMS(DEFINE_AVX2_KERNEL)
+DEFINE_KERNEL(sse2, __attribute__((target("sse2"))), generic, points->dim)
+DEFINE_KERNEL(avx2, __attribute__((target("avx2"))), generic, points->dim)
+#define KERNEL_SET(D) {D, assign_scalar_d##D, assign_sse2_d##D, assign_avx2_d##D},
+#else
+#define KERNEL_SET(D) {D, assign_scalar_d##D, NULL, NULL},
+#endif
+
+typedef struct {
+    int dim;
+    AssignKernel scalar;
+    AssignKernel sse2;
+    AssignKernel avx2;
+} KernelSet;
+
+// Последний набор — общий, для любой размерности
+static const KernelSet kernel_sets[] = {
+    KERNEL_DIMS(KERNEL_SET)
+#ifdef KMEANS_X86_SIMD
+    {0, assign_scalar_generic, assign_sse2_generic, assign_avx2_generic}
+#else
+    {0, assign_scalar_generic, NULL, NULL}
+#endif
+};
+
+int select_kernel(const char *name, int dim) {
+    size_t count = sizeof(kernel_sets) / sizeof(kernel_sets[0]);
+    const KernelSet *set = &kernel_sets[count - 1];
+    for (size_t s = 0; s + 1 < count; s++) {
+        if (kernel_sets[s].dim == dim) {
+            set = &kernel_sets[s];
+        }
+    }
+
+    int automatic = name == NULL || strcmp(name, "auto") == 0;
+    if (automatic || strcmp(name, "scalar") == 0) {
+        assign_kernel = set->scalar;
+    }
+#ifdef KMEANS_X86_SIMD
+    __builtin_cpu_init();
+    if ((automatic || strcmp(name, "sse2") == 0) && __builtin_cpu_supports("sse2")) {
+        assign_kernel = set->sse2;
+    }
+    if ((automatic || strcmp(name, "avx2") == 0) && __builtin_cpu_supports("avx2")) {
+        assign_kernel = set->avx2;
+    }
+#endif
+    return assign_kernel != NULL ? 0 : -1;
+}
+
+// Отсечение не меняет ответ полного перебора: отброшенный центр строго
+// дальше текущего, а среди посчитанных ближайший выбирается так же, по
+// квадрату расстояния и меньшему номеру при равенстве.
+static inline int strictly_closer(double distance, double bound) {
+    return distance * (1 + PRUNE_SLACK) < bound;
+}
+
+static inline int set_cluster(PointStore *points, int i, int cluster_id) {
+    if (points->cluster_id[i] == cluster_id) {
+        return 0;
+    }
+    points->cluster_id[i] = cluster_id;
+    return 1;
+}
+
+int assign_hamerly(ThreadArgs *args, int start, int end) {
+    PointStore *points = args->points;
+    const double *centers = args->local_centers;
+    int k = args->k;
+    int dim = points->dim;
+    int moved = 0;
+    long distances = 0;
+
+    for (int i = start; i < end; i++) {
+        int a = points->cluster_id[i];
+
+        if (!pruning.first_pass) {
+            pruning.upper[i] += pruning.center_shift[a];
+            pruning.lower[i] -= a == pruning.max_shift_id ? pruning.second_max_shift : pruning.max_shift;
+            double bound = fmax(pruning.half_gap[a], pruning.lower[i]);
+            if (strictly_closer(pruning.upper[i], bound)) {
+                add_to_sum(args->sums, a, point_base(points, i, dim), dim);
+                continue;
+            }
+            pruning.upper[i] = sqrt(squared_distance(points, i, centers + (size_t)a * dim, dim));
+            distances++;
+            if (strictly_closer(pruning.upper[i], bound)) {
+                add_to_sum(args->sums, a, point_base(points, i, dim), dim);
+                continue;
+            }
+        }
+
+        double best = INFINITY;
+        double second = INFINITY;
+        int best_cluster = 0;
+        for (int j = 0; j < k; j++) {
+            double dist = squared_distance(points, i, centers + (size_t)j * dim, dim);
+            if (dist < best) {
+                second = best;
+                best = dist;
+                best_cluster = j;
+            } else if (dist < second) {
+                second = dist;
+            }
+        }
+        distances += k;
+        pruning.upper[i] = sqrt(best);
+        pruning.lower[i] = sqrt(second);
+        add_to_sum(args->sums, best_cluster, point_base(points, i, dim), dim);
+        moved += set_cluster(points, i, best_cluster);
+    }
+
+    args->distances += distances;
+    return moved;
+}
+
+int assign_elkan(ThreadArgs *args, int start, int end) {
+    PointStore *points = args->points;
+    const double *centers = args->local_centers;
+    int k = args->k;
+    int dim = points->dim;
+    int moved = 0;
+    long distances = 0;
+
+    for (int i = start; i < end; i++) {
+        double *lower = pruning.lower + (size_t)i * k;
+        int best_cluster = points->cluster_id[i];
+        double best;
+
+        if (pruning.first_pass) {
+            best = INFINITY;
+            for (int j = 0; j < k; j++) {
+                double dist = squared_distance(points, i, centers + (size_t)j * dim, dim);
+                lower[j] = sqrt(dist);
+                if (dist < best) {
+                    best = dist;
+                    best_cluster = j;
+                }
+            }
+            distances += k;
+        } else {
+            pruning.upper[i] += pruning.center_shift[best_cluster];
+            for (int j = 0; j < k; j++) {
+                double bound = lower[j] - pruning.center_shift[j];
+                lower[j] = bound > 0 ? bound : 0;
+            }
+            if (strictly_closer(pruning.upper[i], pruning.half_gap[best_cluster])) {
+                add_to_sum(args->sums, best_cluster, point_base(points, i, dim), dim);
+                continue;
+            }
+
+            int a = best_cluster;
+            best = squared_distance(points, i, centers + (size_t)a * dim, dim);
+            lower[a] = sqrt(best);
+            distances++;
+            for (int j = 0; j < k; j++) {
+                if (j == a) {
+                    continue;
+                }
+                double half_dist = 0.5 * pruning.center_dist[(size_t)best_cluster * k + j];
+                double bound = lower[j] > half_dist ? lower[j] : half_dist;
+                if (strictly_closer(lower[best_cluster], bound)) {
+                    continue;
+                }
+                double dist = squared_distance(points, i, centers + (size_t)j * dim, dim);
+                lower[j] = sqrt(dist);
+                distances++;
+                if (dist < best || (dist == best && j < best_cluster)) {
+                    best = dist;
+                    best_cluster = j;
+                }
+            }
+        }
+
+        pruning.upper[i] = sqrt(best);
+        add_to_sum(args->sums, best_cluster, point_base(points, i, dim), dim);
+        moved += set_cluster(points, i, best_cluster);
+    }
+
+    args->distances += distances;
+    return moved;
+}
+
+// Следующий отрезок точек потока; first — первый ли это вызов за проход.
+// Возвращает 0, когда точек для потока больше нет.
+static int next_chunk(ThreadArgs *args, int first, int *start, int *end) {
+    if (scheduler.chunk_size == 0) {
+        *start = args->start_idx;
+        *end = args->end_idx;
+        return first;
+    }
+    *start = atomic_fetch_add_explicit(&scheduler.cursor, scheduler.chunk_size, memory_order_relaxed);
+    if (*start >= scheduler.count) {
+        return 0;
+    }
+    *end = scheduler.count - *start < scheduler.chunk_size ? scheduler.count : *start + scheduler.chunk_size;
+    return 1;
+}
+
+static double elapsed_seconds(const struct timespec *from, const struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) / 1e9;
+}
+
+// Сумма квадратов расстояний точек [start, end) до их центров (инерция).
+// Отдельный проход на n * dim операций: Хамерли и Элкан точное расстояние
+// до своего центра считают не всегда.
+double chunk_inertia(const PointStore *points, int start, int end, const double *centers) {
+    int dim = points->dim;
+    double inertia = 0;
+    for (int i = start; i < end; i++) {
+        inertia += squared_distance(points, i, centers + (size_t)points->cluster_id[i] * dim, dim);
+    }
+    return inertia;
+}
+
+void assign_clusters(ThreadArgs *args) {
+    struct timespec started, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    memset(args->sums->coords, 0, sizeof(double) * args->k * args->points->dim);
+    memset(args->sums->count, 0, sizeof(long) * args->k);
+    long moved = 0;
+    double inertia = 0;
+    int start, end;
+    for (int first = 1; next_chunk(args, first, &start, &end); first = 0) {
+        switch (pruning.algorithm) {
+        case ALGO_HAMERLY:
+            moved += assign_hamerly(args, start, end);
+            break;
+        case ALGO_ELKAN:
+            moved += assign_elkan(args, start, end);
+            break;
+        default:
+            moved += assign_kernel(args->points, start, end, args->local_centers, args->k, args->sums);
+            args->distances += (long)(end - start) * args->k;
+            break;
+        }
+        if (collect_inertia) {
+            inertia += chunk_inertia(args->points, start, end, args->local_centers);
+        }
+        args->assigned_points += end - start;
+    }
+    args->moved = moved;
+    args->inertia = inertia;
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    args->assign_seconds = elapsed_seconds(&started, &finished);
+    args->busy_seconds += args->assign_seconds;
+}
+
+// Каждый поток сводит суммы всех потоков для своего отрезка кластеров.
+// Центр пустого кластера, как и раньше, становится (0, 0).
+// В мини-пакетном режиме центр сдвигается к среднему своих точек пакета
+// с шагом m / v, где m — точки центра в пакете, v — все его точки с
+// начала: это поточечное обновление c += (x - c) / v, сведённое в один шаг.
+void reduce_centers(ThreadArgs *args) {
+    args->max_shift = 0;
+    if (center_update == UPDATE_NONE) {
+        return;
+    }
+    int dim = args->points->dim;
+    for (int j = args->center_start; j < args->center_end; j++) {
+        long count = 0;
+        for (int t = 0; t < args->num_threads; t++) {
+            count += args->thread_sums[t].count[j];
+        }
+
+        double *center = args->centers + (size_t)j * dim;
+        double shift = 0;
+        for (int d = 0; d < dim; d++) {
+            double sum = 0;
+            for (int t = 0; t < args->num_threads; t++) {
+                sum += args->thread_sums[t].coords[(size_t)j * dim + d];
+            }
+
+            double value;
+            if (center_update == UPDATE_MINIBATCH) {
+                value = count > 0 ? center[d] + (sum - count * center[d]) / (center_seen[j] + count) : center[d];
+            } else {
+                value = count > 0 ? sum / count : 0;
+            }
+            double diff = value - center[d];
+            shift += diff * diff;
+            center[d] = value;
+        }
+
+        if (shift > args->max_shift) {
+            args->max_shift = shift;
+        }
+        if (center_update == UPDATE_MINIBATCH) {
+            center_seen[j] += count;
+        } else if (pruning.algorithm != ALGO_LLOYD) {
+            pruning.center_shift[j] = sqrt(shift);
+        }
+    }
+    args->max_shift = sqrt(args->max_shift);
+}
+
+static uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += UINT64_C(0x9E3779B97F4A7C15));
+    z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+}
+
+static double next_unit(uint64_t *state) {
+    return (double)(next_random(state) >> 11) / (double)(UINT64_C(1) << 53);
+}
+
+// Учитывает новых кандидатов в min_dist и считает стоимость отрезка.
+// Первый вызов заполняет min_dist с нуля: страницы достаются потоку отрезка.
+void seed_update_task(ThreadArgs *args) {
+    PointStore *points = args->points;
+    double cost = 0;
+    for (int i = args->start_idx; i < args->end_idx; i++) {
+        double dist = seeding.applied > 0 ? seeding.min_dist[i] : INFINITY;
+        for (int c = seeding.applied; c < seeding.candidate_count; c++) {
+            double candidate = squared_distance(points, i, seeding.candidates + (size_t)c * points->dim, points->dim);
+            if (candidate < dist) {
+                dist = candidate;
+            }
+        }
+        seeding.min_dist[i] = dist;
+        cost += dist;
+    }
+    seeding.thread_cost[args->thread_id] = cost;
+}
+
+// Раунд k-means||: каждая точка берётся в кандидаты независимо с
+// вероятностью oversampling * d^2 / cost. Случайное число зависит только
+// от seed, раунда и номера точки, поэтому выбор не зависит от числа потоков.
+void seed_sample_task(ThreadArgs *args) {
+    int count = 0;
+    for (int i = args->start_idx; i < args->end_idx; i++) {
+        uint64_t state = seeding.seed ^ ((uint64_t)seeding.round << 40) ^ (uint64_t)i;
+        if (next_unit(&state) * seeding.total_cost < seeding.oversampling * seeding.min_dist[i]) {
+            seeding.thread_picks[args->thread_id][count++] = i;
+        }
+    }
+    seeding.thread_pick_count[args->thread_id] = count;
+}
+
+// Вес кандидата — число точек, для которых он ближайший
+void seed_weight_task(ThreadArgs *args) {
+    PointStore *points = args->points;
+    long *weights = seeding.thread_weights[args->thread_id];
+    memset(weights, 0, sizeof(long) * seeding.candidate_count);
+    for (int i = args->start_idx; i < args->end_idx; i++) {
+        weights[nearest_center(points, i, seeding.candidates, seeding.candidate_count, points->dim)]++;
+    }
+}
+
+void* assign_clusters_thread(void* arg) {
+    ThreadArgs *args = (ThreadArgs*) arg;
+
+    for (;;) {
+        pthread_barrier_wait(&iteration_barrier);
+        if (!atomic_load(&pool_running)) {
+            break;
+        }
+        if (pool_task) {
+            pool_task(args);
+            pthread_barrier_wait(&iteration_barrier);
+            continue;
+        }
+        assign_clusters(args);
+        pthread_barrier_wait(&reduce_barrier);
+        struct timespec started, finished;
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        reduce_centers(args);
+        clock_gettime(CLOCK_MONOTONIC, &finished);
+        args->reduce_seconds = elapsed_seconds(&started, &finished);
+        pthread_barrier_wait(&iteration_barrier);
+    }
+
+    return NULL;
+}
+
+// Расстояния между новыми центрами и их сдвиги за итерацию. Считается
+// главным потоком между итерациями: это k^2 / 2 расстояний против n * k.
+void update_center_bounds(const double *centers, int k, int dim) {
+    for (int j = 0; j < k; j++) {
+        pruning.half_gap[j] = INFINITY;
+    }
+    for (int a = 0; a < k; a++) {
+        for (int b = a + 1; b < k; b++) {
+            double dist = sqrt(center_distance(centers + (size_t)a * dim, centers + (size_t)b * dim, dim));
+            if (pruning.center_dist) {
+                pruning.center_dist[(size_t)a * k + b] = dist;
+                pruning.center_dist[(size_t)b * k + a] = dist;
+            }
+            pruning.half_gap[a] = fmin(pruning.half_gap[a], 0.5 * dist);
+            pruning.half_gap[b] = fmin(pruning.half_gap[b], 0.5 * dist);
+        }
+    }
+
+    pruning.max_shift = 0;
+    pruning.second_max_shift = 0;
+    pruning.max_shift_id = -1;
+    for (int j = 0; j < k; j++) {
+        double shift = pruning.center_shift[j];
+        if (shift > pruning.max_shift) {
+            pruning.second_max_shift = pruning.max_shift;
+            pruning.max_shift = shift;
+            pruning.max_shift_id = j;
+        } else if (shift > pruning.second_max_shift) {
+            pruning.second_max_shift = shift;
+        }
+    }
+}
+
+int pruning_init(Algorithm algorithm, int n, int k) {
+    pruning.algorithm = algorithm;
+    if (algorithm == ALGO_LLOYD) {
+        return 0;
+    }
+    size_t lower_count = algorithm == ALGO_ELKAN ? (size_t)n * k : (size_t)n;
+    pruning.upper = aligned_array(n, sizeof(double));
+    pruning.lower = aligned_array(lower_count, sizeof(double));
+    pruning.center_shift = calloc(k, sizeof(double));
+    pruning.half_gap = malloc(sizeof(double) * k);
+    if (algorithm == ALGO_ELKAN) {
+        pruning.center_dist = calloc((size_t)k * k, sizeof(double));
+    }
+    pruning.first_pass = 1;
+    return pruning.upper && pruning.lower && pruning.center_shift && pruning.half_gap &&
+           (algorithm != ALGO_ELKAN || pruning.center_dist) ? 0 : -1;
+}
+
+void pruning_free(void) {
+    free(pruning.upper);
+    free(pruning.lower);
+    free(pruning.center_shift);
+    free(pruning.half_gap);
+    free(pruning.center_dist);
+}
+
+static const char *algorithm_names[] = {"lloyd", "hamerly", "elkan"};
+
+int parse_algorithm(const char *name, Algorithm *algorithm) {
+    if (name == NULL || strcmp(name, "lloyd") == 0) {
+        *algorithm = ALGO_LLOYD;
+    } else if (strcmp(name, "hamerly") == 0) {
+        *algorithm = ALGO_HAMERLY;
+    } else if (strcmp(name, "elkan") == 0) {
+        *algorithm = ALGO_ELKAN;
+    } else if (strcmp(name, "auto") == 0) {
+        *algorithm = ALGO_AUTO;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// Отсечение окупается только при многих центрах: при K < AUTO_PRUNE_MIN_K
+// обход границ дороже сэкономленных расстояний. Элкан держит K границ на
+// точку и выигрывает, когда одно расстояние дорогое (dim >= AUTO_ELKAN_MIN_DIM);
+// Хамерли с одной границей — только на малых dim, где расстояние почти
+// бесплатно и главное — не обходить все K центров. Между ними (и на
+// равномерных точках почти везде) быстрее всего Ллойд.
+Algorithm choose_algorithm(int k, int dim) {
+    if (k < AUTO_PRUNE_MIN_K) {
+        return ALGO_LLOYD;
+    }
+    if (dim >= AUTO_ELKAN_MIN_DIM) {
+        return ALGO_ELKAN;
+    }
+    return dim <= AUTO_HAMERLY_MAX_DIM ? ALGO_HAMERLY : ALGO_LLOYD;
+}
+
+void set_thread_ranges(ThreadArgs *args, int num_threads, int n) {
+    scheduler.count = n;
+    int points_per_thread = n / num_threads;
+    int remaining_points = n % num_threads;
+    int current_idx = 0;
+    for (int t = 0; t < num_threads; t++) {
+        args[t].start_idx = current_idx;
+        args[t].end_idx = current_idx + points_per_thread + (t < remaining_points ? 1 : 0);
+        current_idx = args[t].end_idx;
+    }
+}
+
+void replicate_centers(void) {
+    for (int node = 0; numa.node_centers && node < numa.used_nodes; node++) {
+        memcpy(numa.node_centers[node], numa.centers, sizeof(double) * numa.center_count);
+    }
+}
+
+// Один проход пула по текущим точкам: назначение и пересчёт центров
+void pool_iteration(void) {
+    atomic_store(&scheduler.cursor, 0);
+    pthread_barrier_wait(&iteration_barrier);
+    pthread_barrier_wait(&iteration_barrier);
+    if (!pool_task) {
+        replicate_centers();
+    }
+}
+
+void run_pool_task(PoolTask task) {
+    pool_task = task;
+    pool_iteration();
+    pool_task = NULL;
+}
+
+int seeding_add_candidate(const PointStore *points, int i) {
+    int dim = points->dim;
+    if (seeding.candidate_count == seeding.candidate_capacity) {
+        int capacity = seeding.candidate_capacity > 0 ? seeding.candidate_capacity * 2 : 64;
+        double *candidates = realloc(seeding.candidates, sizeof(double) * dim * capacity);
+        if (!candidates) {
+            return -1;
+        }
+        seeding.candidates = candidates;
+        seeding.candidate_capacity = capacity;
+    }
+    double *candidate = seeding.candidates + (size_t)seeding.candidate_count * dim;
+    for (int d = 0; d < dim; d++) {
+        candidate[d] = point_coord(points, i, d);
+    }
+    seeding.candidate_count++;
+    return 0;
+}
+
+// Добавляет кандидатов в min_dist параллельно и пересчитывает общую стоимость
+void seeding_apply_candidates(int num_threads) {
+    run_pool_task(seed_update_task);
+    seeding.applied = seeding.candidate_count;
+    seeding.total_cost = 0;
+    for (int t = 0; t < num_threads; t++) {
+        seeding.total_cost += seeding.thread_cost[t];
+    }
+}
+
+// Точка с вероятностью, пропорциональной min_dist: поток выбирается по
+// стоимостям отрезков, затем просматривается только его отрезок.
+int seeding_pick_weighted(const ThreadArgs *args, int num_threads, uint64_t *rng) {
+    double target = next_unit(rng) * seeding.total_cost;
+    int t = 0;
+    while (t < num_threads - 1 && target >= seeding.thread_cost[t]) {
+        target -= seeding.thread_cost[t];
+        t++;
+    }
+    int last = args[t].start_idx;
+    for (int i = args[t].start_idx; i < args[t].end_idx; i++) {
+        if (seeding.min_dist[i] > 0) {
+            last = i;
+            if (target < seeding.min_dist[i]) {
+                return i;
+            }
+            target -= seeding.min_dist[i];
+        }
+    }
+    return last;
+}
+
+int seeding_init(int n, int num_threads, uint64_t seed) {
+    memset(&seeding, 0, sizeof(seeding));
+    seeding.seed = seed;
+    seeding.min_dist = malloc(sizeof(double) * (n > 0 ? n : 1));
+    seeding.thread_cost = calloc(num_threads, sizeof(double));
+    seeding.thread_picks = calloc(num_threads, sizeof(int*));
+    seeding.thread_pick_count = calloc(num_threads, sizeof(int));
+    seeding.thread_weights = calloc(num_threads, sizeof(long*));
+    if (!seeding.min_dist || !seeding.thread_cost || !seeding.thread_picks ||
+        !seeding.thread_pick_count || !seeding.thread_weights) {
+        return -1;
+    }
+    return 0;
+}
+
+void seeding_free(int num_threads) {
+    for (int t = 0; t < num_threads; t++) {
+        if (seeding.thread_picks) free(seeding.thread_picks[t]);
+        if (seeding.thread_weights) free(seeding.thread_weights[t]);
+    }
+    free(seeding.min_dist);
+    free(seeding.candidates);
+    free(seeding.thread_cost);
+    free(seeding.thread_picks);
+    free(seeding.thread_pick_count);
+    free(seeding.thread_weights);
+}
+
+// k-means++: k последовательных выборов, после каждого пул обновляет
+// расстояния до ближайшего центра
+int init_kmeans_pp(PointStore *points, ThreadArgs *args, int num_threads, double *centers, int k) {
+    uint64_t rng = seeding.seed;
+    int first = (int)(next_random(&rng) % (uint64_t)points->count);
+    if (seeding_add_candidate(points, first) != 0) {
+        return -1;
+    }
+    seeding_apply_candidates(num_threads);
+
+    while (seeding.candidate_count < k) {
+        int i = seeding_pick_weighted(args, num_threads, &rng);
+        if (seeding_add_candidate(points, i) != 0) {
+            return -1;
+        }
+        seeding_apply_candidates(num_threads);
+    }
+
+    memcpy(centers, seeding.candidates, sizeof(double) * k * points->dim);
+    return 0;
+}
+
+// Взвешенный k-means++ по кандидатам k-means|| (их O(k * раунды),
+// поэтому считается главным потоком)
+void reduce_candidates(const long *weights, double *centers, int k, int dim, uint64_t *rng) {
+    int m = seeding.candidate_count;
+    double *dist = seeding.min_dist;
+    double total = 0;
+    for (int c = 0; c < m; c++) {
+        total += weights[c];
+    }
+
+    int chosen = m - 1;
+    double target = next_unit(rng) * total;
+    for (int c = 0; c < m; c++) {
+        if (target < weights[c]) {
+            chosen = c;
+            break;
+        }
+        target -= weights[c];
+    }
+
+    for (int j = 0; j < k; j++) {
+        if (j > 0) {
+            total = 0;
+            for (int c = 0; c < m; c++) {
+                total += weights[c] * dist[c];
+            }
+            chosen = -1;
+            target = next_unit(rng) * total;
+            for (int c = 0; c < m && total > 0; c++) {
+                double share = weights[c] * dist[c];
+                if (share > 0) {
+                    chosen = c;
+                    if (target < share) {
+                        break;
+                    }
+                    target -= share;
+                }
+            }
+            // Кандидатов меньше k или все совпали с выбранными центрами
+            if (chosen < 0) {
+                chosen = j % m;
+            }
+        }
+
+        double *center = centers + (size_t)j * dim;
+        memcpy(center, seeding.candidates + (size_t)chosen * dim, sizeof(double) * dim);
+        for (int c = 0; c < m; c++) {
+            double d = center_distance(seeding.candidates + (size_t)c * dim, center, dim);
+            if (j == 0 || d < dist[c]) {
+                dist[c] = d;
+            }
+        }
+    }
+}
+
+// k-means||: несколько раундов параллельной выборки с запасом
+// (oversampling * k кандидатов на раунд), затем взвешенный k-means++
+// сводит кандидатов к k центрам.
+int init_kmeans_parallel(PointStore *points, ThreadArgs *args, int num_threads, double *centers, int k) {
+    uint64_t rng = seeding.seed;
+    int first = (int)(next_random(&rng) % (uint64_t)points->count);
+    if (seeding_add_candidate(points, first) != 0) {
+        return -1;
+    }
+    seeding_apply_candidates(num_threads);
+
+    for (int t = 0; t < num_threads; t++) {
+        seeding.thread_picks[t] = malloc(sizeof(int) * (args[t].end_idx - args[t].start_idx + 1));
+        if (!seeding.thread_picks[t]) {
+            return -1;
+        }
+    }
+
+    seeding.oversampling = SEED_OVERSAMPLING * k;
+    for (seeding.round = 0; seeding.round < SEED_ROUNDS && seeding.total_cost > 0; seeding.round++) {
+        run_pool_task(seed_sample_task);
+        for (int t = 0; t < num_threads; t++) {
+            for (int p = 0; p < seeding.thread_pick_count[t]; p++) {
+                int i = seeding.thread_picks[t][p];
+                if (seeding_add_candidate(points, i) != 0) {
+                    return -1;
+                }
+            }
+        }
+        seeding_apply_candidates(num_threads);
+    }
+
+    long *weights = calloc(seeding.candidate_count, sizeof(long));
+    if (!weights) {
+        return -1;
+    }
+    for (int t = 0; t < num_threads; t++) {
+        seeding.thread_weights[t] = malloc(sizeof(long) * seeding.candidate_count);
+        if (!seeding.thread_weights[t]) {
+            free(weights);
+            return -1;
+        }
+    }
+    run_pool_task(seed_weight_task);
+    for (int t = 0; t < num_threads; t++) {
+        for (int c = 0; c < seeding.candidate_count; c++) {
+            weights[c] += seeding.thread_weights[t][c];
+        }
+    }
+
+    reduce_candidates(weights, centers, k, points->dim, &rng);
+    free(weights);
+    return 0;
+}
+
+int parse_init(const char *name, InitMethod *method) {
+    if (name == NULL || strcmp(name, "first") == 0) {
+        *method = INIT_FIRST;
+    } else if (strcmp(name, "kmeans++") == 0) {
+        *method = INIT_KMEANS_PP;
+    } else if (strcmp(name, "kmeans||") == 0) {
+        *method = INIT_KMEANS_PARALLEL;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int parse_points_header(const unsigned char *header, int *dim, long *count) {
+    unsigned int dimension;
+    unsigned long long total;
+
+    if (memcmp(header, POINTS_MAGIC, 4) != 0) {
+        return -1;
+    }
+    memcpy(&dimension, header + 4, sizeof(dimension));
+    memcpy(&total, header + 8, sizeof(total));
+    if (dimension == 0 || dimension > INT32_MAX / sizeof(double) || total > INT64_MAX) {
+        return -1;
+    }
+    *dim = (int)dimension;
+    *count = (long)total;
+    return 0;
+}
+
+// Раскладывает точки [start, end) из записанных подряд по строкам rows
+// по блокам points
+void point_store_load_rows(PointStore *points, const double *rows, int start, int end) {
+    int dim = points->dim;
+    for (int i = start; i < end; i++) {
+        double *point = point_base(points, i, dim);
+        const double *row = rows + (size_t)i * dim;
+        for (int d = 0; d < dim; d++) {
+            point[d * POINT_BLOCK] = row[d];
+        }
+        points->cluster_id[i] = 0;
+    }
+}
+
+int point_reader_open(PointReader *reader, const char *path, int capacity) {
+    unsigned char header[POINTS_HEADER_SIZE];
+
+    reader->file = fopen(path, "rb");
+    if (!reader->file) {
+        return -1;
+    }
+    if (fread(header, 1, sizeof(header), reader->file) != sizeof(header) ||
+        parse_points_header(header, &reader->dim, &reader->count) != 0) {
+        fclose(reader->file);
+        return -1;
+    }
+
+    reader->remaining = reader->count;
+    reader->capacity = capacity;
+    reader->buffer = malloc(sizeof(double) * reader->dim * capacity);
+    if (!reader->buffer) {
+        fclose(reader->file);
+        return -1;
+    }
+    return 0;
+}
+
+int point_reader_rewind(PointReader *reader) {
+    reader->remaining = reader->count;
+    return fseek(reader->file, POINTS_HEADER_SIZE, SEEK_SET);
+}
+
+// Читает до capacity точек в начало points; возвращает их число,
+// 0 в конце файла и -1 при ошибке.
+int point_reader_read(PointReader *reader, PointStore *points) {
+    int n = reader->remaining < reader->capacity ? (int)reader->remaining : reader->capacity;
+    if (n == 0) {
+        return 0;
+    }
+    if (fread(reader->buffer, sizeof(double) * reader->dim, n, reader->file) != (size_t)n) {
+        return -1;
+    }
+    point_store_load_rows(points, reader->buffer, 0, n);
+    reader->remaining -= n;
+    return n;
+}
+
+void point_reader_close(PointReader *reader) {
+    fclose(reader->file);
+    free(reader->buffer);
+}
+
+// Отображает весь файл точек в память (--points). Координаты потом
+// копируются из отображения прямо в блоки точек, без промежуточного
+// буфера и разбора: каждый поток пула — свой отрезок (first_touch_task).
 typedef struct {
-    double x, y;
-} Point;
+    const unsigned char *data;
+    size_t size;
+    int dim;
+    long count;
+} PointsMapping;
+
+int map_points_file(PointsMapping *mapping, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < POINTS_HEADER_SIZE) {
+        close(fd);
+        return -1;
+    }
+    mapping->size = st.st_size;
+    mapping->data = mmap(NULL, mapping->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping->data == MAP_FAILED) {
+        return -1;
+    }
+    madvise((void*)mapping->data, mapping->size, MADV_SEQUENTIAL);
+
+    if (parse_points_header(mapping->data, &mapping->dim, &mapping->count) != 0 || mapping->count <= 0 ||
+        mapping->count > INT32_MAX ||
+        (mapping->size - POINTS_HEADER_SIZE) / sizeof(double) / mapping->dim < (size_t)mapping->count) {
+        munmap((void*)mapping->data, mapping->size);
+        return -1;
+    }
+    return 0;
+}
+
+void unmap_points_file(PointsMapping *mapping) {
+    munmap((void*)mapping->data, mapping->size);
+}
+
+// Записывает count случайных точек того же вида, что generate_random_points
+int write_points_file(const char *path, long count, int dim, unsigned int seed) {
+    double *buffer = malloc(sizeof(double) * dim * DEFAULT_BATCH_SIZE);
+    FILE *file = fopen(path, "wb");
+    if (!file || !buffer) {
+        if (file) fclose(file);
+        free(buffer);
+        return -1;
+    }
+
+    unsigned char header[POINTS_HEADER_SIZE] = POINTS_MAGIC;
+    unsigned int dimension = (unsigned int)dim;
+    unsigned long long total = (unsigned long long)count;
+    memcpy(header + 4, &dimension, sizeof(dimension));
+    memcpy(header + 8, &total, sizeof(total));
+    int ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    srand(seed);
+    for (long written = 0; ok && written < count; ) {
+        int n = count - written < DEFAULT_BATCH_SIZE ? (int)(count - written) : DEFAULT_BATCH_SIZE;
+        for (int i = 0; i < n * dim; i++) {
+            buffer[i] = (double)(rand() % 1000) / 10;
+        }
+        ok = fwrite(buffer, sizeof(double) * dim, n, file) == (size_t)n;
+        written += n;
+    }
+
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    free(buffer);
+    return ok ? 0 : -1;
+}
+
+int parse_stats_format(const char *name, StatsFormat *format) {
+    if (name == NULL || strcmp(name, "csv") == 0) {
+        *format = STATS_CSV;
+    } else if (strcmp(name, "json") == 0) {
+        *format = STATS_JSON;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// CSV — строка на итерацию; JSON — параметры запуска и массив итераций
+int stats_writer_open(StatsWriter *writer, const char *path, StatsFormat format, int n, int k, int dim,
+                      int threads, Algorithm algorithm) {
+    writer->file = fopen(path, "w");
+    writer->format = format;
+    writer->rows = 0;
+    if (!writer->file) {
+        return -1;
+    }
+    if (format == STATS_JSON) {
+        fprintf(writer->file, "{\n  \"points\": %d,\n  \"k\": %d,\n  \"dim\": %d,\n  \"threads\": %d,\n"
+                              "  \"algorithm\": \"%s\",\n  \"iterations\": [",
+                n, k, dim, threads, algorithm_names[algorithm]);
+    } else {
+        fprintf(writer->file, "iteration,moved,inertia,max_shift,wall_s,assign_s,reduce_s,sync_s\n");
+    }
+    return 0;
+}
+
+void stats_writer_write(StatsWriter *writer, const IterationStats *stats) {
+    if (writer->format == STATS_JSON) {
+        fprintf(writer->file, "%s\n    {\"iteration\": %d, \"moved\": %ld, \"inertia\": %.10g, \"max_shift\": %.10g, "
+                              "\"wall_s\": %.6f, \"assign_s\": %.6f, \"reduce_s\": %.6f, \"sync_s\": %.6f}",
+                writer->rows > 0 ? "," : "", stats->iteration, stats->moved, stats->inertia, stats->max_shift,
+                stats->wall_seconds, stats->assign_seconds, stats->reduce_seconds, stats->sync_seconds);
+    } else {
+        fprintf(writer->file, "%d,%ld,%.10g,%.10g,%.6f,%.6f,%.6f,%.6f\n", stats->iteration, stats->moved,
+                stats->inertia, stats->max_shift, stats->wall_seconds, stats->assign_seconds,
+                stats->reduce_seconds, stats->sync_seconds);
+    }
+    writer->rows++;
+}
+
+int stats_writer_close(StatsWriter *writer) {
+    if (writer->format == STATS_JSON) {
+        fprintf(writer->file, "\n  ]\n}\n");
+    }
+    return fclose(writer->file) == 0 ? 0 : -1;
+}
+
+// Сводит счётчики потоков за итерацию: один проход главного потока по
+// ThreadArgs вместо записи каждым потоком в общую переменную. bounds —
+// время расчёта границ центров главным потоком до прохода пула.
+IterationStats collect_iteration_stats(const ThreadArgs *args, int num_threads, int iteration,
+                                       double wall_seconds, double bounds_seconds) {
+    IterationStats stats = {iteration, 0, 0, 0, wall_seconds, 0, 0, 0};
+    for (int t = 0; t < num_threads; t++) {
+        stats.moved += args[t].moved;
+        stats.inertia += args[t].inertia;
+        if (args[t].max_shift > stats.max_shift) stats.max_shift = args[t].max_shift;
+        if (args[t].assign_seconds > stats.assign_seconds) stats.assign_seconds = args[t].assign_seconds;
+        if (args[t].reduce_seconds > stats.reduce_seconds) stats.reduce_seconds = args[t].reduce_seconds;
+    }
+    stats.reduce_seconds += bounds_seconds;
+    stats.sync_seconds = wall_seconds - stats.assign_seconds - stats.reduce_seconds;
+    if (stats.sync_seconds < 0) {
+        stats.sync_seconds = 0;
+    }
+    return stats;
+}
+
+int parse_label_format(const char *name, LabelFormat *format) {
+    if (name == NULL || strcmp(name, "text") == 0) {
+        *format = LABELS_TEXT;
+    } else if (strcmp(name, "binary") == 0) {
+        *format = LABELS_BINARY;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int label_writer_open(LabelWriter *writer, const char *path, LabelFormat format, long count, int k) {
+    writer->file = fopen(path, "wb");
+    writer->format = format;
+    writer->buffer = malloc(LABELS_BUFFER_SIZE);
+    writer->length = 0;
+    writer->ok = 1;
+    if (!writer->file || !writer->buffer) {
+        if (writer->file) fclose(writer->file);
+        free(writer->buffer);
+        return -1;
+    }
+    if (format == LABELS_BINARY) {
+        unsigned int clusters = (unsigned int)k;
+        unsigned long long total = (unsigned long long)count;
+        memcpy(writer->buffer, LABELS_MAGIC, 4);
+        memcpy(writer->buffer + 4, &clusters, sizeof(clusters));
+        memcpy(writer->buffer + 8, &total, sizeof(total));
+        writer->length = LABELS_HEADER_SIZE;
+    }
+    return 0;
+}
+
+static void label_writer_flush(LabelWriter *writer) {
+    if (writer->length > 0 && fwrite(writer->buffer, 1, writer->length, writer->file) != writer->length) {
+        writer->ok = 0;
+    }
+    writer->length = 0;
+}
+
+// Дописывает метки n точек. Текст форматируется вручную: printf на
+// каждую метку при миллионах точек медленнее самой кластеризации.
+void label_writer_write(LabelWriter *writer, const int *ids, int n) {
+    if (writer->format == LABELS_BINARY) {
+        for (int i = 0; i < n; ) {
+            if (writer->length + sizeof(int32_t) > LABELS_BUFFER_SIZE) {
+                label_writer_flush(writer);
+            }
+            int room = (int)((LABELS_BUFFER_SIZE - writer->length) / sizeof(int32_t));
+            int part = n - i < room ? n - i : room;
+            memcpy(writer->buffer + writer->length, ids + i, sizeof(int32_t) * part);
+            writer->length += sizeof(int32_t) * part;
+            i += part;
+        }
+        return;
+    }
+
+    for (int i = 0; i < n; i++) {
+        // 10 цифр int и перевод строки
+        if (writer->length + 12 > LABELS_BUFFER_SIZE) {
+            label_writer_flush(writer);
+        }
+        char digits[12];
+        int length = 0;
+        unsigned int id = (unsigned int)ids[i];
+        do {
+            digits[length++] = (char)('0' + id % 10);
+            id /= 10;
+        } while (id > 0);
+        while (length > 0) {
+            writer->buffer[writer->length++] = digits[--length];
+        }
+        writer->buffer[writer->length++] = '\n';
+    }
+}
+
+int label_writer_close(LabelWriter *writer) {
+    label_writer_flush(writer);
+    if (fclose(writer->file) != 0) {
+        writer->ok = 0;
+    }
+    free(writer->buffer);
+    return writer->ok ? 0 : -1;
+}
+
+// Мини-пакетный k-means: epochs проходов по файлу пакетами, каждый пакет —
+// одна итерация пула. С labels_path после обучения ещё один проход пишет
+// номер кластера каждой точки в формате labels_format.
+int run_minibatch(PointReader *reader, ThreadArgs *args, int k, int epochs, const char *labels_path,
+                  LabelFormat labels_format) {
+    center_seen = calloc(k, sizeof(long));
+    if (!center_seen) {
+        fprintf(stderr, "Ошибка выделения памяти\n");
+        return -1;
+    }
+
+    int n = 0;
+    center_update = UPDATE_MINIBATCH;
+    for (int epoch = 1; epoch <= epochs; epoch++) {
+        long batches = 0;
+        if (point_reader_rewind(reader) != 0) {
+            n = -1;
+            break;
+        }
+        while ((n = point_reader_read(reader, &global_points)) > 0) {
+            set_thread_ranges(args, num_threads_max, n);
+            pool_iteration();
+            batches++;
+        }
+        if (n < 0) {
+            break;
+        }
+        printf("Эпоха %d завершена, пакетов: %ld\n", epoch, batches);
+    }
+
+    if (n == 0 && labels_path) {
+        LabelWriter labels;
+        if (label_writer_open(&labels, labels_path, labels_format, reader->count, k) != 0) {
+            fprintf(stderr, "Не удалось создать файл меток %s\n", labels_path);
+            return -1;
+        }
+        center_update = UPDATE_NONE;
+        n = point_reader_rewind(reader) == 0 ? 0 : -1;
+        while (n >= 0 && (n = point_reader_read(reader, &global_points)) > 0) {
+            set_thread_ranges(args, num_threads_max, n);
+            pool_iteration();
+            label_writer_write(&labels, global_points.cluster_id, n);
+        }
+        if (label_writer_close(&labels) != 0 && n == 0) {
+            n = -1;
+        }
+    }
+
+    if (n < 0) {
+        fprintf(stderr, "Ошибка чтения или записи файла точек\n");
+        return -1;
+    }
+    return 0;
+}
+
+static const char *transport_names[] = {"shm", "socket"};
+
+int parse_transport(const char *name, Transport *transport) {
+    if (name == NULL || strcmp(name, "shm") == 0) {
+        *transport = TRANSPORT_SHM;
+    } else if (strcmp(name, "socket") == 0) {
+        *transport = TRANSPORT_SOCKET;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static size_t aligned_size(size_t bytes) {
+    return (bytes + POINT_ALIGNMENT - 1) / POINT_ALIGNMENT * POINT_ALIGNMENT;
+}
+
+static void *segment_take(unsigned char **cursor, size_t bytes) {
+    void *block = *cursor;
+    *cursor += aligned_size(bytes);
+    return block;
+}
+
+// Сегмент создаётся до fork (MAP_SHARED | MAP_ANONYMOUS), поэтому у всех
+// процессов он по одному адресу. Для сокетов суммы и отчёты — обычная
+// память координатора: рабочий после fork пользуется своей копией.
+int process_group_init(Transport transport, int processes, int k, int dim, int n, double *centers) {
+    size_t center_bytes = sizeof(double) * k * dim;
+    group.transport = transport;
+    group.processes = processes;
+    group.k = k;
+    group.dim = dim;
+    group.exchange_seconds = 0;
+    group.loop_seconds = 0;
+    group.pids = calloc(processes, sizeof(pid_t));
+    group.sums = calloc(processes, sizeof(ClusterSums));
+    if (!group.pids || !group.sums) {
+        return -1;
+    }
+
+    if (transport == TRANSPORT_SOCKET) {
+        group.centers = centers;
+        group.reports = aligned_array(processes, sizeof(WorkerReport));
+        group.sockets = malloc(sizeof(int) * processes);
+        if (!group.reports || !group.sockets) {
+            return -1;
+        }
+        for (int w = 0; w < processes; w++) {
+            group.sockets[w] = -1;
+            group.sums[w].coords = aligned_array((size_t)k * dim, sizeof(double));
+            group.sums[w].count = aligned_array(k, sizeof(long));
+            if (!group.sums[w].coords || !group.sums[w].count) {
+                return -1;
+            }
+        }
+        // Команда и центры к каждому рабочему, отчёт и суммы обратно
+        group.bytes_per_iteration = processes * (sizeof(uint64_t) + center_bytes +
+                                                 sizeof(WorkerReport) + center_bytes + sizeof(long) * k);
+        return 0;
+    }
+
+    group.segment_size = aligned_size(sizeof(atomic_uint)) * 2 + aligned_size(sizeof(atomic_int)) +
+                         aligned_size(center_bytes) + aligned_size(sizeof(int) * n) +
+                         processes * (sizeof(WorkerReport) + aligned_size(center_bytes) +
+                                      aligned_size(sizeof(long) * k));
+    group.segment = mmap(NULL, group.segment_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (group.segment == MAP_FAILED) {
+        group.segment = NULL;
+        return -1;
+    }
+    unsigned char *cursor = group.segment;
+    group.phase = segment_take(&cursor, sizeof(atomic_uint));
+    group.done = segment_take(&cursor, sizeof(atomic_uint));
+    group.running = segment_take(&cursor, sizeof(atomic_int));
+    group.centers = segment_take(&cursor, center_bytes);
+    group.labels = segment_take(&cursor, sizeof(int) * n);
+    group.reports = segment_take(&cursor, sizeof(WorkerReport) * processes);
+    for (int w = 0; w < processes; w++) {
+        group.sums[w].coords = segment_take(&cursor, center_bytes);
+        group.sums[w].count = segment_take(&cursor, sizeof(long) * k);
+    }
+    memcpy(group.centers, centers, center_bytes);
+    atomic_init(group.phase, 0);
+    atomic_init(group.done, 0);
+    atomic_init(group.running, 1);
+    // Координатор пишет центры, рабочие — отчёты, суммы и счётчики
+    group.bytes_per_iteration = center_bytes + processes * (sizeof(WorkerReport) + center_bytes + sizeof(long) * k);
+    return 0;
+}
+
+void process_group_free(void) {
+    if (group.segment) {
+        munmap(group.segment, group.segment_size);
+    } else if (group.sums) {
+        for (int w = 0; w < group.processes; w++) {
+            free(group.sums[w].coords);
+            free(group.sums[w].count);
+        }
+        free(group.reports);
+    }
+    for (int w = 0; group.sockets && w < group.processes; w++) {
+        if (group.sockets[w] >= 0) {
+            close(group.sockets[w]);
+        }
+    }
+    free(group.sockets);
+    free(group.sums);
+    free(group.pids);
+}
+
+// MSG_NOSIGNAL: упавший рабочий — ошибка обмена, а не SIGPIPE координатору
+static int write_full(int fd, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    while (size > 0) {
+        ssize_t written = send(fd, bytes, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return -1;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return 0;
+}
+
+static int read_full(int fd, void *data, size_t size) {
+    unsigned char *bytes = data;
+    while (size > 0) {
+        ssize_t got = read(fd, bytes, size);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return -1;
+        }
+        bytes += got;
+        size -= got;
+    }
+    return 0;
+}
+
+// Сегмент общий для процессов, поэтому futex без FUTEX_PRIVATE_FLAG.
+// Возвращает -1 и errno ETIMEDOUT, если timeout истёк.
+static int futex_wait(atomic_uint *address, unsigned int expected, const struct timespec *timeout) {
+    return (int)syscall(SYS_futex, address, FUTEX_WAIT, expected, timeout, NULL, 0);
+}
+
+static void futex_wake(atomic_uint *address, int count) {
+    syscall(SYS_futex, address, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+// Цикл рабочего процесса; fd — его конец сокета (для shm -1).
+// По сокету координатор шлёт команду (uint64: 1 — итерация, 0 — конец)
+// и центры, рабочий отвечает отчётом, суммами и счётчиками, а после
+// команды конца — метками своих точек.
+static void worker_main(const ThreadArgs *range, int fd) {
+    int w = range->thread_id;
+    int start = range->start_idx;
+    int end = range->end_idx;
+    int k = group.k;
+    size_t center_bytes = sizeof(double) * k * group.dim;
+    ClusterSums *sums = &group.sums[w];
+    WorkerReport *report = &group.reports[w];
+    int status = 0;
+    unsigned int phase = 0;
+
+    for (;;) {
+        if (group.transport == TRANSPORT_SHM) {
+            unsigned int current;
+            while ((current = atomic_load(group.phase)) == phase) {
+                futex_wait(group.phase, phase, NULL);
+            }
+            phase = current;
+            if (!atomic_load(group.running)) {
+                break;
+            }
+        } else {
+            uint64_t command;
+            if (read_full(fd, &command, sizeof(command)) != 0 ||
+                (command != 0 && read_full(fd, group.centers, center_bytes) != 0)) {
+                status = 1;
+                break;
+            }
+            if (command == 0) {
+                break;
+            }
+        }
+
+        struct timespec started, finished;
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        memset(sums->coords, 0, center_bytes);
+        memset(sums->count, 0, sizeof(long) * k);
+        report->moved = assign_kernel(&global_points, start, end, group.centers, k, sums);
+        clock_gettime(CLOCK_MONOTONIC, &finished);
+        report->assign_seconds = elapsed_seconds(&started, &finished);
+
+        if (group.transport == TRANSPORT_SHM) {
+            if (atomic_fetch_add(group.done, 1) + 1 == (unsigned int)group.processes) {
+                futex_wake(group.done, 1);
+            }
+        } else if (write_full(fd, report, sizeof(*report)) != 0 ||
+                   write_full(fd, sums->coords, center_bytes) != 0 ||
+                   write_full(fd, sums->count, sizeof(long) * k) != 0) {
+            status = 1;
+            break;
+        }
+    }
+
+    const int *labels = global_points.cluster_id + start;
+    if (group.transport == TRANSPORT_SHM) {
+        memcpy(group.labels + start, labels, sizeof(int) * (end - start));
+    } else if (status == 0 && write_full(fd, labels, sizeof(int) * (end - start)) != 0) {
+        status = 1;
+    }
+    // Буферы stdio — копия координаторских, сбрасывать их нельзя
+    _exit(status);
+}
+
+// Запускает рабочих; при ошибке завершает уже запущенных
+static int start_workers(const ThreadArgs *args) {
+    pid_t coordinator = getpid();
+    for (int w = 0; w < group.processes; w++) {
+        int pair[2] = {-1, -1};
+        if (group.transport == TRANSPORT_SOCKET && socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+            perror("Ошибка создания сокета");
+        } else {
+            group.pids[w] = fork();
+            if (group.pids[w] == 0) {
+                // Без координатора рабочий ждал бы следующей фазы вечно
+                prctl(PR_SET_PDEATHSIG, SIGKILL);
+                if (getppid() != coordinator) {
+                    _exit(1);
+                }
+                for (int i = 0; group.sockets && i < w; i++) {
+                    close(group.sockets[i]);
+                }
+                if (pair[0] >= 0) {
+                    close(pair[0]);
+                }
+                worker_main(&args[w], pair[1]);
+            }
+            if (pair[1] >= 0) {
+                close(pair[1]);
+            }
+            if (group.pids[w] > 0) {
+                if (group.sockets) {
+                    group.sockets[w] = pair[0];
+                }
+                continue;
+            }
+            perror("Ошибка создания процесса");
+            if (pair[0] >= 0) {
+                close(pair[0]);
+            }
+        }
+
+        for (int i = 0; i < w; i++) {
+            kill(group.pids[i], SIGKILL);
+            waitpid(group.pids[i], NULL, 0);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+static void shm_next_phase(void) {
+    atomic_store(group.done, 0);
+    atomic_fetch_add(group.phase, 1);
+    futex_wake(group.phase, INT_MAX);
+}
+
+// Рабочий, завершившийся до команды конца, — ошибка. Забранные здесь
+// процессы помечаются pid 0, чтобы их не ждали повторно.
+static int reap_exited_workers(void) {
+    int exited = 0;
+    for (int w = 0; w < group.processes; w++) {
+        if (group.pids[w] > 0 && waitpid(group.pids[w], NULL, WNOHANG) == group.pids[w]) {
+            group.pids[w] = 0;
+            exited = 1;
+        }
+    }
+    return exited ? -1 : 0;
+}
+
+static int shm_wait_done(void) {
+    const struct timespec timeout = {0, WORKER_POLL_NS};
+    unsigned int done;
+    while ((done = atomic_load(group.done)) < (unsigned int)group.processes) {
+        if (futex_wait(group.done, done, &timeout) != 0 && errno == ETIMEDOUT && reap_exited_workers() != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Одна итерация со стороны координатора: центры — рабочим, суммы — от них
+static int exchange_iteration(void) {
+    if (group.transport == TRANSPORT_SHM) {
+        shm_next_phase();
+        return shm_wait_done();
+    }
+    size_t center_bytes = sizeof(double) * group.k * group.dim;
+    uint64_t command = 1;
+    for (int w = 0; w < group.processes; w++) {
+        if (write_full(group.sockets[w], &command, sizeof(command)) != 0 ||
+            write_full(group.sockets[w], group.centers, center_bytes) != 0) {
+            return -1;
+        }
+    }
+    for (int w = 0; w < group.processes; w++) {
+        if (read_full(group.sockets[w], &group.reports[w], sizeof(WorkerReport)) != 0 ||
+            read_full(group.sockets[w], group.sums[w].coords, center_bytes) != 0 ||
+            read_full(group.sockets[w], group.sums[w].count, sizeof(long) * group.k) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// После ошибки обмена потоки данных в сокетах рассогласованы (рабочие
+// могут стоять в send с неотданными суммами), а метки неполны: рабочих
+// не останавливают командой, а убивают и забирают
+static void kill_workers(void) {
+    for (int w = 0; w < group.processes; w++) {
+        if (group.pids[w] > 0) {
+            kill(group.pids[w], SIGKILL);
+            waitpid(group.pids[w], NULL, 0);
+            group.pids[w] = 0;
+        }
+    }
+}
+
+// Останавливает рабочих после чистой итерации, собирает их метки и ждёт
+// завершения
+static int stop_workers(const ThreadArgs *args) {
+    int status = 0;
+    if (group.transport == TRANSPORT_SHM) {
+        atomic_store(group.running, 0);
+        shm_next_phase();
+    } else {
+        uint64_t command = 0;
+        for (int w = 0; w < group.processes; w++) {
+            int *labels = global_points.cluster_id + args[w].start_idx;
+            if (write_full(group.sockets[w], &command, sizeof(command)) != 0 ||
+                read_full(group.sockets[w], labels, sizeof(int) * (args[w].end_idx - args[w].start_idx)) != 0) {
+                status = -1;
+            }
+        }
+    }
+    for (int w = 0; w < group.processes; w++) {
+        int exit_status;
+        if (group.pids[w] <= 0 || waitpid(group.pids[w], &exit_status, 0) < 0 || !WIFEXITED(exit_status) ||
+            WEXITSTATUS(exit_status) != 0) {
+            status = -1;
+        }
+    }
+    if (status == 0 && group.transport == TRANSPORT_SHM) {
+        memcpy(global_points.cluster_id, group.labels, sizeof(int) * global_points.count);
+    }
+    return status;
+}
 
-typedef struct {
-    double x, y;
-    int cluster_id;
-} PointData;
+// Итерации Ллойда на процессах group: ход и печать — как у пула потоков.
+// Центры сводит reduce_centers по суммам процессов, поэтому при тех же
+// отрезках результат совпадает с потоками бит в бит. Время обмена —
+// время итерации до получения всех сумм минус назначение у самого
+// медленного рабочего.
+int run_processes(ThreadArgs *args, double *centers, int k, int max_iterations, double tolerance,
+                  int *iterations, int *converged, double *max_shift) {
+    if (start_workers(args) != 0) {
+        return -1;
+    }
 
-typedef struct {
-    double x, y;
-    int count;
-} ClusterCenter;
+    ThreadArgs reduce_args = {
+        .points = &global_points,
+        .centers = group.centers,
+        .k = k,
+        .thread_sums = group.sums,
+        .num_threads = group.processes,
+        .center_start = 0,
+        .center_end = k
+    };
+    long moved = 1;
+    int status = 0;
+    while (moved > 0 && !*converged && *iterations < max_iterations) {
+        (*iterations)++;
 
-typedef struct {
-    int thread_id;
-    int start_idx;
-    int end_idx;
-    PointData *points;
-    ClusterCenter *centers;
-    int k;
-    atomic_int *changed;
-} ThreadArgs;
+        struct timespec started, exchanged, reduced;
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        if (exchange_iteration() != 0) {
+            fprintf(stderr, "Ошибка обмена с рабочими процессами\n");
+            status = -1;
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &exchanged);
+        moved = 0;
+        double assign_seconds = 0;
+        for (int w = 0; w < group.processes; w++) {
+            moved += group.reports[w].moved;
+            if (group.reports[w].assign_seconds > assign_seconds) {
+                assign_seconds = group.reports[w].assign_seconds;
+            }
+        }
+        reduce_centers(&reduce_args);
+        clock_gettime(CLOCK_MONOTONIC, &reduced);
+        group.exchange_seconds += elapsed_seconds(&started, &exchanged) - assign_seconds;
+        group.loop_seconds += elapsed_seconds(&started, &reduced);
 
-PointData *global_points = NULL;
-int total_points = 0;
-int num_threads_max = 0;
+        *max_shift = reduce_args.max_shift;
+        *converged = tolerance > 0 && *max_shift < tolerance;
+        printf("Итерация %d завершена, изменения: %s\n",
+               *iterations, moved > 0 ? "да" : "нет");
+    }
 
-double distance(Point p1, Point p2) {
-    return sqrt((p1.x - p2.x) * (p1.x - p2.x) + (p1.y - p2.y) * (p1.y - p2.y));
+    if (status != 0) {
+        kill_workers();
+    } else if (stop_workers(args) != 0) {
+        fprintf(stderr, "Рабочий процесс завершился с ошибкой\n");
+        status = -1;
+    }
+    if (group.centers != centers) {
+        memcpy(centers, group.centers, sizeof(double) * k * group.dim);
+    }
+    return status;
 }
 
-void* assign_clusters_thread(void* arg) {
-    ThreadArgs *args = (ThreadArgs*) arg;
+// Разбирает список K вида "2-8,16,32"; возвращает число значений или -1
+int parse_k_list(const char *text, int **ks) {
+    int count = 0;
+    const char *cursor = text;
+    *ks = malloc(sizeof(int) * SWEEP_MAX_MODELS);
+    while (*ks) {
+        char *end;
+        long first = strtol(cursor, &end, 10);
+        long last = first;
+        if (end == cursor || first <= 0) {
+            break;
+        }
+        if (*end == '-') {
+            cursor = end + 1;
+            last = strtol(cursor, &end, 10);
+            if (end == cursor || last < first) {
+                break;
+            }
+        }
+        if (last - first >= SWEEP_MAX_MODELS - count) {
+            break;
+        }
+        for (long k = first; k <= last; k++) {
+            (*ks)[count++] = (int)k;
+        }
+        if (*end == '\0') {
+            return count;
+        }
+        if (*end != ',') {
+            break;
+        }
+        cursor = end + 1;
+    }
+    free(*ks);
+    *ks = NULL;
+    return -1;
+}
 
-    for (int i = args->start_idx; i < args->end_idx; i++) {
-        double min_dist = distance((Point){args->points[i].x, args->points[i].y}, 
-                                    (Point){args->centers[0].x, args->centers[0].y});
-        int best_cluster = 0;
+// Модель видит общие координаты точек со своими метками
+static inline PointStore sweep_view(const PointStore *points, const SweepModel *model) {
+    PointStore view = *points;
+    view.cluster_id = model->labels;
+    return view;
+}
 
-        for (int j = 1; j < args->k; j++) {
-            double dist = distance((Point){args->points[i].x, args->points[i].y},
-                                   (Point){args->centers[j].x, args->centers[j].y});
-            if (dist < min_dist) {
-                min_dist = dist;
-                best_cluster = j;
+// Как first_touch_task: метки и суммы модели размещает поток, который
+// будет с ними работать
+void sweep_touch_task(ThreadArgs *args) {
+    int t = args->thread_id;
+    int dim = args->points->dim;
+    for (int m = 0; m < sweep.count; m++) {
+        SweepModel *model = &sweep.models[m];
+        memset(model->labels + args->start_idx, 0, sizeof(int) * (args->end_idx - args->start_idx));
+        model->thread_sums[t].coords = aligned_array((size_t)model->k * dim, sizeof(double));
+        model->thread_sums[t].count = aligned_array(model->k, sizeof(long));
+    }
+}
+
+void sweep_assign_task(ThreadArgs *args) {
+    int t = args->thread_id;
+    int dim = args->points->dim;
+    for (int m = 0; m < sweep.count; m++) {
+        SweepModel *model = &sweep.models[m];
+        if (model->active) {
+            memset(model->thread_sums[t].coords, 0, sizeof(double) * model->k * dim);
+            memset(model->thread_sums[t].count, 0, sizeof(long) * model->k);
+            model->thread_moved[t] = 0;
+        }
+    }
+    for (int start = args->start_idx; start < args->end_idx; start += sweep.tile) {
+        int end = args->end_idx - start < sweep.tile ? args->end_idx : start + sweep.tile;
+        for (int m = 0; m < sweep.count; m++) {
+            SweepModel *model = &sweep.models[m];
+            if (model->active) {
+                PointStore view = sweep_view(args->points, model);
+                model->thread_moved[t] += assign_kernel(&view, start, end, model->centers, model->k,
+                                                        &model->thread_sums[t]);
             }
         }
+        args->assigned_points += end - start;
+    }
+}
+
+void sweep_inertia_task(ThreadArgs *args) {
+    int t = args->thread_id;
+    for (int m = 0; m < sweep.count; m++) {
+        sweep.models[m].thread_inertia[t] = 0;
+    }
+    for (int start = args->start_idx; start < args->end_idx; start += sweep.tile) {
+        int end = args->end_idx - start < sweep.tile ? args->end_idx : start + sweep.tile;
+        for (int m = 0; m < sweep.count; m++) {
+            SweepModel *model = &sweep.models[m];
+            PointStore view = sweep_view(args->points, model);
+            model->thread_inertia[t] += chunk_inertia(&view, start, end, model->centers);
+        }
+    }
+}
 
-        if (args->points[i].cluster_id != best_cluster) {
-            args->points[i].cluster_id = best_cluster;
-            atomic_store(args->changed, 1);
+// Заводит модели для ks и выбирает их начальные центры: первые K точек
+// или k-means++/k-means|| отдельно для каждой модели с тем же seed
+int sweep_init(const int *ks, int count, ThreadArgs *args, int num_threads, InitMethod init_method,
+               uint64_t seed) {
+    PointStore *points = &global_points;
+    int dim = points->dim;
+    sweep.count = count;
+    sweep.passes = 0;
+    sweep.tile = SWEEP_TILE_BYTES / (int)sizeof(double) / dim / CHUNK_ALIGNMENT * CHUNK_ALIGNMENT;
+    if (sweep.tile < CHUNK_ALIGNMENT) {
+        sweep.tile = CHUNK_ALIGNMENT;
+    }
+    sweep.models = calloc(count, sizeof(SweepModel));
+    if (!sweep.models) {
+        sweep.count = 0;
+        return -1;
+    }
+    for (int m = 0; m < count; m++) {
+        SweepModel *model = &sweep.models[m];
+        model->k = ks[m];
+        model->active = 1;
+        model->centers = aligned_array((size_t)model->k * dim, sizeof(double));
+        model->labels = aligned_array(points->count, sizeof(int));
+        model->thread_sums = calloc(num_threads, sizeof(ClusterSums));
+        model->thread_moved = calloc(num_threads, sizeof(long));
+        model->thread_inertia = calloc(num_threads, sizeof(double));
+        if (!model->centers || !model->labels || !model->thread_sums || !model->thread_moved ||
+            !model->thread_inertia) {
+            return -1;
         }
     }
 
-    pthread_exit(NULL);
-    return NULL;
+    run_pool_task(sweep_touch_task);
+    for (int m = 0; m < count; m++) {
+        SweepModel *model = &sweep.models[m];
+        for (int t = 0; t < num_threads; t++) {
+            if (!model->thread_sums[t].coords || !model->thread_sums[t].count) {
+                return -1;
+            }
+        }
+
+        if (init_method == INIT_FIRST) {
+            for (int i = 0; i < model->k; i++) {
+                for (int d = 0; d < dim; d++) {
+                    model->centers[(size_t)i * dim + d] = point_coord(points, i, d);
+                }
+            }
+            continue;
+        }
+        int status = seeding_init(points->count, num_threads, seed);
+        if (status == 0 && init_method == INIT_KMEANS_PP) {
+            status = init_kmeans_pp(points, args, num_threads, model->centers, model->k);
+        } else if (status == 0) {
+            status = init_kmeans_parallel(points, args, num_threads, model->centers, model->k);
+        }
+        seeding_free(num_threads);
+        if (status != 0) {
+            return -1;
+        }
+    }
+    return 0;
 }
 
-void recalculate_centers(PointData *points, int n, ClusterCenter *centers, int k) {
-    for (int i = 0; i < k; i++) {
-        centers[i].x = 0;
-        centers[i].y = 0;
-        centers[i].count = 0;
+void sweep_free(int num_threads) {
+    for (int m = 0; m < sweep.count; m++) {
+        SweepModel *model = &sweep.models[m];
+        for (int t = 0; model->thread_sums && t < num_threads; t++) {
+            free(model->thread_sums[t].coords);
+            free(model->thread_sums[t].count);
+        }
+        free(model->thread_sums);
+        free(model->thread_moved);
+        free(model->thread_inertia);
+        free(model->labels);
+        free(model->centers);
     }
+    free(sweep.models);
+    sweep.models = NULL;
+    sweep.count = 0;
+}
 
-    for (int i = 0; i < n; i++) {
-        int cluster_id = points[i].cluster_id;
-        centers[cluster_id].x += points[i].x;
-        centers[cluster_id].y += points[i].y;
-        centers[cluster_id].count++;
+// Итерации всех моделей: проход пула назначает точки активным моделям,
+// затем главный поток сводит центры каждой. В конце ещё один общий
+// проход считает инерцию всех моделей с их итоговыми центрами.
+void run_sweep(ThreadArgs *args, int num_threads, int max_iterations, double tolerance) {
+    int active = sweep.count;
+    while (active > 0) {
+        run_pool_task(sweep_assign_task);
+        sweep.passes++;
+
+        for (int m = 0; m < sweep.count; m++) {
+            SweepModel *model = &sweep.models[m];
+            if (!model->active) {
+                continue;
+            }
+            long moved = 0;
+            for (int t = 0; t < num_threads; t++) {
+                moved += model->thread_moved[t];
+            }
+            ThreadArgs reduce_args = {
+                .points = args[0].points,
+                .centers = model->centers,
+                .k = model->k,
+                .thread_sums = model->thread_sums,
+                .num_threads = num_threads,
+                .center_start = 0,
+                .center_end = model->k
+            };
+            reduce_centers(&reduce_args);
+            model->iterations++;
+            model->converged = moved == 0 || (tolerance > 0 && reduce_args.max_shift < tolerance);
+            if (model->converged || model->iterations >= max_iterations) {
+                model->active = 0;
+                active--;
+            }
+        }
+
+        printf("Итерация %d завершена, активных моделей: %d из %d\n", sweep.passes, active, sweep.count);
     }
 
-    for (int i = 0; i < k; i++) {
-        if (centers[i].count > 0) {
-            centers[i].x /= centers[i].count;
-            centers[i].y /= centers[i].count;
+    run_pool_task(sweep_inertia_task);
+    for (int m = 0; m < sweep.count; m++) {
+        SweepModel *model = &sweep.models[m];
+        model->inertia = 0;
+        for (int t = 0; t < num_threads; t++) {
+            model->inertia += model->thread_inertia[t];
+        }
+    }
+}
+
+// Разбирает список вида "0-3,8,10-11" (cpulist и online в sysfs)
+int parse_cpu_list(const char *text, cpu_set_t *set) {
+    CPU_ZERO(set);
+    while (*text && *text != '\n') {
+        char *end;
+        long first = strtol(text, &end, 10);
+        long last = first;
+        if (end == text) {
+            return -1;
+        }
+        if (*end == '-') {
+            text = end + 1;
+            last = strtol(text, &end, 10);
+            if (end == text) {
+                return -1;
+            }
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, set);
+        }
+        text = *end == ',' ? end + 1 : end;
+    }
+    return 0;
+}
+
+int read_cpu_list(const char *path, cpu_set_t *set) {
+    char text[4096];
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+    int ok = fgets(text, sizeof(text), file) != NULL;
+    fclose(file);
+    return ok ? parse_cpu_list(text, set) : -1;
+}
+
+int numa_discover(void) {
+    cpu_set_t allowed, online;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return -1;
+    }
+    numa.node_ids = malloc(sizeof(int) * CPU_SETSIZE);
+    numa.node_cpus = malloc(sizeof(cpu_set_t) * CPU_SETSIZE);
+    if (!numa.node_ids || !numa.node_cpus) {
+        return -1;
+    }
+
+    numa.node_count = 0;
+    if (read_cpu_list(NUMA_SYSFS "/online", &online) == 0) {
+        for (int node = 0; node < CPU_SETSIZE; node++) {
+            char path[64];
+            cpu_set_t cpus;
+            snprintf(path, sizeof(path), NUMA_SYSFS "/node%d/cpulist", node);
+            if (!CPU_ISSET(node, &online) || read_cpu_list(path, &cpus) != 0) {
+                continue;
+            }
+            CPU_AND(&cpus, &cpus, &allowed);
+            if (CPU_COUNT(&cpus) > 0) {
+                numa.node_ids[numa.node_count] = node;
+                numa.node_cpus[numa.node_count++] = cpus;
+            }
+        }
+    }
+    if (numa.node_count == 0) {
+        numa.node_ids[0] = 0;
+        numa.node_cpus[0] = allowed;
+        numa.node_count = 1;
+    }
+    return 0;
+}
+
+// Делит потоки между первыми max_nodes узлами (0 — все) подряд и
+// закрепляет каждый за своим процессором узла по кругу.
+int numa_place_threads(int num_threads, int max_nodes) {
+    numa.used_nodes = max_nodes > 0 && max_nodes < numa.node_count ? max_nodes : numa.node_count;
+    if (numa.used_nodes > num_threads) {
+        numa.used_nodes = num_threads;
+    }
+    numa.thread_cpu = malloc(sizeof(int) * num_threads);
+    numa.thread_node = malloc(sizeof(int) * num_threads);
+    if (!numa.thread_cpu || !numa.thread_node) {
+        return -1;
+    }
+
+    int first_thread = 0;
+    for (int t = 0; t < num_threads; t++) {
+        int node = (int)((long)t * numa.used_nodes / num_threads);
+        if (t == 0 || node != numa.thread_node[t - 1]) {
+            first_thread = t;
+        }
+        const cpu_set_t *cpus = &numa.node_cpus[node];
+        int skip = (t - first_thread) % CPU_COUNT(cpus);
+        int cpu = 0;
+        while (!CPU_ISSET(cpu, cpus) || skip-- > 0) {
+            cpu++;
+        }
+        numa.thread_cpu[t] = cpu;
+        numa.thread_node[t] = node;
+    }
+
+    if (numa.used_nodes > 1) {
+        numa.node_centers = calloc(numa.used_nodes, sizeof(double*));
+        if (!numa.node_centers) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void numa_free(void) {
+    for (int node = 0; numa.node_centers && node < numa.used_nodes; node++) {
+        free(numa.node_centers[node]);
+    }
+    free(numa.node_centers);
+    free(numa.node_ids);
+    free(numa.node_cpus);
+    free(numa.thread_cpu);
+    free(numa.thread_node);
+}
+
+// Первое касание памяти — с потока, который потом её обрабатывает: по
+// умолчанию Linux отдаёт страницу узлу, на котором её впервые записали.
+// Блок точек принадлежит потоку, в отрезке которого его первая точка.
+// С --points поток сразу копирует свои строки из отображения файла,
+// иначе заполняет память нулями, а точки пишет генератор. Суммы потока
+// и копию центров узла (её выделяет первый поток узла) поток тоже
+// выделяет сам.
+void first_touch_task(ThreadArgs *args) {
+    PointStore *points = args->points;
+    int dim = points->dim;
+    int first = (args->start_idx + POINT_BLOCK - 1) / POINT_BLOCK * POINT_BLOCK;
+    int end = (args->end_idx + POINT_BLOCK - 1) / POINT_BLOCK * POINT_BLOCK;
+    if (end > first) {
+        memset(points->coords + (size_t)first * dim, 0, sizeof(double) * (end - first) * dim);
+        if (end > points->count) {
+            end = points->count;
+        }
+        memset(points->cluster_id + first, 0, sizeof(int) * (end - first));
+        if (numa.rows) {
+            point_store_load_rows(points, numa.rows, first, end);
+        }
+    }
+
+    args->sums->coords = aligned_array((size_t)args->k * dim, sizeof(double));
+    args->sums->count = aligned_array(args->k, sizeof(long));
+    if (numa.node_centers && args->node_leader) {
+        numa.node_centers[args->node] = aligned_array(numa.center_count, sizeof(double));
+        if (numa.node_centers[args->node]) {
+            memset(numa.node_centers[args->node], 0, sizeof(double) * numa.center_count);
         }
     }
 }
 
-void generate_random_points(PointData *points, int n) {
+void generate_random_points(PointStore *points) {
     srand(time(NULL));
-    for (int i = 0; i < n; i++) {
-        points[i].x = (double)(rand() % 1000) / 10;
-        points[i].y = (double)(rand() % 1000) / 10;
-        points[i].cluster_id = 0;
+    for (int i = 0; i < points->count; i++) {
+        for (int d = 0; d < points->dim; d++) {
+            point_base(points, i, points->dim)[d * POINT_BLOCK] = (double)(rand() % 1000) / 10;
+        }
+        points->cluster_id[i] = 0;
+    }
+}
+
+void print_coords(const double *coords, size_t step, int dim) {
+    putchar('(');
+    for (int d = 0; d < dim; d++) {
+        printf(d > 0 ? ", %.2f" : "%.2f", coords[d * step]);
+    }
+    putchar(')');
+}
+
+// Нагрузка потоков за все проходы назначения: сколько точек обработал
+// поток, его доля и время в назначении (без ожидания на барьерах).
+void print_thread_load(const ThreadArgs *args, int num_threads) {
+    long total = 0;
+    for (int t = 0; t < num_threads; t++) {
+        total += args[t].assigned_points;
     }
+    if (scheduler.chunk_size > 0) {
+        printf("\nНагрузка потоков (куски по %d точек):\n", scheduler.chunk_size);
+    } else {
+        printf("\nНагрузка потоков (отрезки поровну):\n");
+    }
+    for (int t = 0; t < num_threads; t++) {
+        printf("Поток %2d: точек %ld (%.1f%%), назначение %.3f с\n", t, args[t].assigned_points,
+               total > 0 ? 100.0 * args[t].assigned_points / total : 0.0, args[t].busy_seconds);
+    }
+}
+
+void print_usage(const char *program) {
+    fprintf(stderr, "Использование: %s [--kernel auto|scalar|sse2|avx2] [--dim D] "
+                    "[--algo lloyd|hamerly|elkan|auto] [--init first|kmeans++|kmeans||] [--seed N]\n"
+                    "       [--labels файл] [--labels-format text|binary] [--quiet] [--pin] [--nodes N] [--chunk N]\n"
+                    "       [--stats файл] [--stats-format csv|json] [--tol EPS]\n"
+                    "       [--processes] [--transport shm|socket] [--sweep K1-K2,K3...]\n"
+                    "       <число_точек> <число_кластеров_K> <макс_потоков>\n"
+                    "       %s --points файл [те же параметры] <число_кластеров_K> <макс_потоков>\n"
+                    "       %s --input файл [--batch N] [--epochs E] [--labels файл] [--labels-format ...] "
+                    "[--kernel ...] <число_кластеров_K> <макс_потоков>\n"
+                    "       %s --write-points файл [--dim D] [--seed N] <число_точек>\n"
+                    "С --points и --input размерность берётся из файла; --points загружает\n"
+                    "файл в память целиком, --input читает его пакетами (мини-пакетный k-means).\n"
+                    "--quiet не печатает точки с их кластерами.\n"
+                    "--pin закрепляет потоки за процессорами по узлам NUMA, --nodes N — только\n"
+                    "за первыми N узлами.\n"
+                    "--chunk N раздаёт точки потокам кусками по N (0 — поровну заранее) и\n"
+                    "печатает нагрузку потоков.\n"
+                    "--stats пишет по каждой итерации: сколько точек сменили кластер, инерцию,\n"
+                    "наибольший сдвиг центра и время фаз. --tol останавливает итерации, когда\n"
+                    "наибольший сдвиг центра меньше EPS.\n"
+                    "--processes запускает вместо <макс_потоков> потоков столько же процессов:\n"
+                    "каждый считает свой отрезок точек, координатор сводит их суммы и\n"
+                    "рассылает центры через общую память (--transport shm) или Unix-сокеты\n"
+                    "(--transport socket) и печатает время обмена.\n"
+                    "--sweep 2-8,16 обучает модели для всех перечисленных K за общие проходы\n"
+                    "по точкам (K в позиционных параметрах тогда не указывается) и печатает\n"
+                    "инерцию каждой; модель останавливается, когда сошлась.\n", program, program, program, program);
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 4) {
-        fprintf(stderr, "Использование: %s <число_точек> <число_кластеров_K> <макс_потоков>\n", argv[0]);
+    static const struct option long_options[] = {
+        {"kernel", required_argument, NULL, 'K'},
+        {"algo", required_argument, NULL, 'A'},
+        {"input", required_argument, NULL, 'i'},
+        {"batch", required_argument, NULL, 'b'},
+        {"epochs", required_argument, NULL, 'e'},
+        {"labels", required_argument, NULL, 'l'},
+        {"write-points", required_argument, NULL, 'w'},
+        {"init", required_argument, NULL, 'I'},
+        {"seed", required_argument, NULL, 's'},
+        {"dim", required_argument, NULL, 'd'},
+        {"points", required_argument, NULL, 'p'},
+        {"labels-format", required_argument, NULL, 'F'},
+        {"quiet", no_argument, NULL, 'q'},
+        {"pin", no_argument, NULL, 'P'},
+        {"nodes", required_argument, NULL, 'N'},
+        {"chunk", required_argument, NULL, 'c'},
+        {"stats", required_argument, NULL, 'S'},
+        {"stats-format", required_argument, NULL, 'f'},
+        {"tol", required_argument, NULL, 't'},
+        {"processes", no_argument, NULL, 'X'},
+        {"transport", required_argument, NULL, 'T'},
+        {"sweep", required_argument, NULL, 'W'},
+        {NULL, 0, NULL, 0}
+    };
+
+    const char *kernel_name = NULL;
+    const char *algorithm_name = NULL;
+    const char *input_path = NULL;
+    const char *labels_path = NULL;
+    const char *write_path = NULL;
+    const char *init_name = NULL;
+    const char *points_path = NULL;
+    const char *labels_format_name = NULL;
+    int quiet = 0;
+    int pin = 0;
+    int max_nodes = 0;
+    int chunk_size = -1;
+    const char *stats_path = NULL;
+    const char *stats_format_name = NULL;
+    double tolerance = 0;
+    int processes = 0;
+    const char *transport_name = NULL;
+    const char *sweep_list = NULL;
+    uint64_t seed = DEFAULT_SEED;
+    int seed_given = 0;
+    int batch_size = DEFAULT_BATCH_SIZE;
+    int epochs = DEFAULT_EPOCHS;
+    int dim = DEFAULT_DIMENSION;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'K':
+            kernel_name = optarg;
+            break;
+        case 'A':
+            algorithm_name = optarg;
+            break;
+        case 'i':
+            input_path = optarg;
+            break;
+        case 'b':
+            batch_size = atoi(optarg);
+            break;
+        case 'e':
+            epochs = atoi(optarg);
+            break;
+        case 'l':
+            labels_path = optarg;
+            break;
+        case 'w':
+            write_path = optarg;
+            break;
+        case 'I':
+            init_name = optarg;
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            seed_given = 1;
+            break;
+        case 'd':
+            dim = atoi(optarg);
+            break;
+        case 'p':
+            points_path = optarg;
+            break;
+        case 'F':
+            labels_format_name = optarg;
+            break;
+        case 'q':
+            quiet = 1;
+            break;
+        case 'P':
+            pin = 1;
+            break;
+        case 'N':
+            max_nodes = atoi(optarg);
+            pin = 1;
+            break;
+        case 'c':
+            chunk_size = atoi(optarg);
+            if (chunk_size < 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'S':
+            stats_path = optarg;
+            break;
+        case 'f':
+            stats_format_name = optarg;
+            break;
+        case 't':
+            tolerance = atof(optarg);
+            break;
+        case 'X':
+            processes = 1;
+            break;
+        case 'T':
+            transport_name = optarg;
+            break;
+        case 'W':
+            sweep_list = optarg;
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (dim <= 0 || max_nodes < 0 || tolerance < 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (write_path) {
+        if (argc - optind != 1) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        // С --seed файл воспроизводим: бенчмарки сравнивают запуски на одних точках
+        unsigned int points_seed = seed_given ? (unsigned int)seed : (unsigned int)time(NULL);
+        if (write_points_file(write_path, atol(argv[optind]), dim, points_seed) != 0) {
+            fprintf(stderr, "Не удалось записать файл точек %s\n", write_path);
+            return 1;
+        }
+        return 0;
+    }
+
+    LabelFormat labels_format;
+    StatsFormat stats_format;
+    Transport transport;
+    int *sweep_ks = NULL;
+    int sweep_count = sweep_list ? parse_k_list(sweep_list, &sweep_ks) : 0;
+    if (argc - optind != (input_path || points_path ? 2 : 3) - (sweep_list ? 1 : 0) || sweep_count < 0 ||
+        batch_size <= 0 || epochs <= 0 ||
+        (input_path && points_path) || parse_label_format(labels_format_name, &labels_format) != 0 ||
+        parse_stats_format(stats_format_name, &stats_format) != 0 ||
+        parse_transport(transport_name, &transport) != 0 || (transport_name && !processes)) {
+        print_usage(argv[0]);
         return 1;
     }
 
-    total_points = atoi(argv[1]);
-    int k = atoi(argv[2]);
-    num_threads_max = atoi(argv[3]);
+    if (!input_path && !points_path) {
+        total_points = atoi(argv[optind++]);
+    }
+    int k = sweep_list ? 0 : atoi(argv[optind++]);
+    num_threads_max = atoi(argv[optind]);
+    for (int m = 0; m < sweep_count; m++) {
+        if (sweep_ks[m] > k) {
+            k = sweep_ks[m];
+        }
+    }
 
     if (num_threads_max <= 0) num_threads_max = 1;
     if (k <= 0) k = 1;
 
-    global_points = (PointData*)malloc(sizeof(PointData) * total_points);
-    ClusterCenter *centers = (ClusterCenter*)malloc(sizeof(ClusterCenter) * k);
+    Algorithm algorithm;
+    if (parse_algorithm(algorithm_name, &algorithm) != 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    InitMethod init_method;
+    if (parse_init(init_name, &init_method) != 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    // В этих режимах есть только Ллойд
+    if (algorithm == ALGO_AUTO && (input_path || processes || sweep_list)) {
+        algorithm = ALGO_LLOYD;
+    }
+    if (input_path && (algorithm != ALGO_LLOYD || init_method != INIT_FIRST)) {
+        fprintf(stderr, "В режиме --input поддерживаются только --algo lloyd и --init first\n");
+        return 1;
+    }
+    if (input_path && (stats_path || tolerance > 0)) {
+        fprintf(stderr, "--stats и --tol работают только с итерациями Ллойда, Хамерли и Элкана\n");
+        return 1;
+    }
+    if (processes && (input_path || algorithm != ALGO_LLOYD || init_method != INIT_FIRST || pin ||
+                      chunk_size >= 0 || stats_path)) {
+        fprintf(stderr, "С --processes поддерживаются только --algo lloyd и --init first, "
+                        "без --input, --pin, --chunk и --stats\n");
+        return 1;
+    }
+    if (sweep_list && (input_path || processes || algorithm != ALGO_LLOYD || chunk_size >= 0 || stats_path ||
+                       labels_path)) {
+        fprintf(stderr, "С --sweep поддерживается только --algo lloyd, "
+                        "без --input, --processes, --chunk, --stats и --labels\n");
+        return 1;
+    }
+
+    // В мини-пакетном режиме в памяти только пакет (не меньше k точек,
+    // чтобы взять из него начальные центры)
+    PointReader reader;
+    if (input_path) {
+        int capacity = batch_size > k ? batch_size : k;
+        if (point_reader_open(&reader, input_path, capacity) != 0) {
+            fprintf(stderr, "Не удалось открыть файл точек %s\n", input_path);
+            return 1;
+        }
+        total_points = capacity;
+        dim = reader.dim;
+    }
+
+    PointsMapping mapping;
+    if (points_path) {
+        if (map_points_file(&mapping, points_path) != 0) {
+            fprintf(stderr, "Не удалось загрузить файл точек %s\n", points_path);
+            return 1;
+        }
+        total_points = (int)mapping.count;
+        dim = mapping.dim;
+        numa.rows = (const double*)(mapping.data + POINTS_HEADER_SIZE);
+    }
 
-    if (!global_points || !centers) {
-        fprintf(stderr, "Ошибка выделения памяти\n");
+    // Начальные центры — первые K точек (с --sweep — наибольшего K)
+    long available = input_path ? reader.count : points_path ? mapping.count : total_points;
+    if (available < k) {
+        fprintf(stderr, "Точек %ld, меньше K=%d\n", available, k);
+        if (input_path) {
+            point_reader_close(&reader);
+        } else if (points_path) {
+            unmap_points_file(&mapping);
+        }
+        free(sweep_ks);
+        return 1;
+    }
+    if (algorithm == ALGO_AUTO) {
+        algorithm = choose_algorithm(k, dim);
+    }
+
+    if (pin && (numa_discover() != 0 || numa_place_threads(num_threads_max, max_nodes) != 0)) {
+        fprintf(stderr, "Не удалось определить процессоры для закрепления потоков\n");
         return 1;
     }
 
-    generate_random_points(global_points, total_points);
+    if (select_kernel(kernel_name, dim) != 0) {
+        fprintf(stderr, "Ядро %s не поддерживается на этом процессоре\n", kernel_name);
+        return 1;
+    }
 
-    for (int i = 0; i < k; i++) {
-        centers[i].x = global_points[i].x;
-        centers[i].y = global_points[i].y;
-        centers[i].count = 0;
+    double *centers = aligned_array((size_t)k * dim, sizeof(double));
+
+    if (point_store_init(&global_points, total_points, dim) != 0 || !centers ||
+        pruning_init(algorithm, total_points, k) != 0) {
+        fprintf(stderr, "Ошибка выделения памяти\n");
+        return 1;
+    }
+    numa.centers = centers;
+    numa.center_count = (size_t)k * dim;
+    if (chunk_size > 0) {
+        scheduler.chunk_size = (chunk_size + CHUNK_ALIGNMENT - 1) / CHUNK_ALIGNMENT * CHUNK_ALIGNMENT;
     }
 
-    printf("Запуск k=%d с потоками: %d, точек: %d\n\n", 
-           k, num_threads_max, total_points);
-    
     int max_iterations = 100;
-    atomic_int changed = 1;
+    long moved = 1;
     int iter = 0;
 
-    while (atomic_load(&changed) && iter < max_iterations) {
-        atomic_store(&changed, 0);
-        iter++;
+    pthread_t threads[num_threads_max];
+    ThreadArgs args[num_threads_max];
+    ClusterSums thread_sums[num_threads_max];
+
+    if (pthread_barrier_init(&iteration_barrier, NULL, num_threads_max + 1) != 0 ||
+        pthread_barrier_init(&reduce_barrier, NULL, num_threads_max) != 0) {
+        fprintf(stderr, "Ошибка создания барьера\n");
+        return 1;
+    }
 
-        int points_per_thread = total_points / num_threads_max;
-        int remaining_points = total_points % num_threads_max;
+    set_thread_ranges(args, num_threads_max, total_points);
+    for (int t = 0; t < num_threads_max; t++) {
+        args[t].thread_id = t;
+        args[t].points = &global_points;
+        args[t].centers = centers;
+        args[t].local_centers = centers;
+        args[t].node = pin ? numa.thread_node[t] : 0;
+        args[t].node_leader = t == 0 || args[t].node != args[t - 1].node;
+        args[t].k = k;
+        args[t].sums = &thread_sums[t];
+        args[t].thread_sums = thread_sums;
+        args[t].num_threads = num_threads_max;
+        args[t].center_start = (int)((long)k * t / num_threads_max);
+        args[t].center_end = (int)((long)k * (t + 1) / num_threads_max);
+        args[t].distances = 0;
+        args[t].assigned_points = 0;
+        args[t].busy_seconds = 0;
+        if (processes) {
+            continue;
+        }
 
-        pthread_t threads[num_threads_max];
-        ThreadArgs args[num_threads_max];
+        // Закреплённый поток сразу стартует на своём процессоре, поэтому
+        // и его стек, и всё, что он первым запишет, окажется на его узле
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (pin) {
+            cpu_set_t cpu;
+            CPU_ZERO(&cpu);
+            CPU_SET(numa.thread_cpu[t], &cpu);
+            pthread_attr_setaffinity_np(&attr, sizeof(cpu), &cpu);
+        }
+        int created = pthread_create(&threads[t], &attr, assign_clusters_thread, (void*)&args[t]);
+        pthread_attr_destroy(&attr);
+        if (created != 0) {
+            perror("Ошибка создания потока");
+            return 1;
+        }
+    }
 
-        int current_idx = 0;
+    if (processes) {
+        // Пула нет: точки заполняет главный поток, рабочие получат их при fork
         for (int t = 0; t < num_threads_max; t++) {
-            args[t].thread_id = t;
-            args[t].start_idx = current_idx;
-            
-            int extra = (t < remaining_points) ? 1 : 0;
-            args[t].end_idx = current_idx + points_per_thread + extra;
-            
-            args[t].points = global_points;
-            args[t].centers = centers;
-            args[t].k = k;
-            args[t].changed = &changed;
-
-            if (pthread_create(&threads[t], NULL, assign_clusters_thread, (void*)&args[t]) != 0) {
-                perror("Ошибка создания потока");
-                return 1;
-            }
+            first_touch_task(&args[t]);
+        }
+    } else {
+        run_pool_task(first_touch_task);
+    }
+    if (points_path) {
+        numa.rows = NULL;
+        unmap_points_file(&mapping);
+    }
+    for (int t = 0; t < num_threads_max; t++) {
+        if (!thread_sums[t].coords || !thread_sums[t].count ||
+            (numa.node_centers && !numa.node_centers[args[t].node])) {
+            fprintf(stderr, "Ошибка выделения памяти\n");
+            return 1;
+        }
+        if (numa.node_centers) {
+            args[t].local_centers = numa.node_centers[args[t].node];
+        }
+    }
 
-            current_idx = args[t].end_idx;
+    if (input_path) {
+        reader.capacity = k;
+        if (point_reader_read(&reader, &global_points) != k) {
+            fprintf(stderr, "Ошибка чтения файла точек %s\n", input_path);
+            return 1;
+        }
+        reader.capacity = batch_size;
+    } else if (!points_path) {
+        generate_random_points(&global_points);
+    }
+
+    for (int i = 0; i < k; i++) {
+        for (int d = 0; d < dim; d++) {
+            centers[(size_t)i * dim + d] = point_coord(&global_points, i, d);
         }
+    }
 
+    if (pin) {
+        printf("Потоки закреплены, узлов NUMA: %d из %d, процессоры:", numa.used_nodes, numa.node_count);
         for (int t = 0; t < num_threads_max; t++) {
-            pthread_join(threads[t], NULL);
+            printf(" %d", numa.thread_cpu[t]);
+        }
+        printf("\n");
+    }
+    const char *workers_name = processes ? "процессами" : "потоками";
+    if (sweep_list) {
+        printf("Запуск K=%s с потоками: %d, точек: %d, размерность: %d\n\n",
+               sweep_list, num_threads_max, total_points, dim);
+    } else if (input_path) {
+        printf("Запуск k=%d с потоками: %d, точек в файле: %ld, размерность: %d, пакет: %d\n\n",
+               k, num_threads_max, reader.count, dim, batch_size);
+    } else if (points_path) {
+        printf("Запуск k=%d с %s: %d, точек в файле: %d, размерность: %d\n\n",
+               k, workers_name, num_threads_max, total_points, dim);
+    } else {
+        printf("Запуск k=%d с %s: %d, точек: %d\n\n", 
+               k, workers_name, num_threads_max, total_points);
+    }
+
+    struct timespec started, seeded, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    int status = 0;
+    if (sweep_list) {
+        status = sweep_init(sweep_ks, sweep_count, args, num_threads_max, init_method, seed);
+        if (status != 0) {
+            fprintf(stderr, "Ошибка выделения памяти\n");
+        }
+    } else if (init_method != INIT_FIRST) {
+        status = seeding_init(total_points, num_threads_max, seed);
+        if (status == 0 && init_method == INIT_KMEANS_PP) {
+            status = init_kmeans_pp(&global_points, args, num_threads_max, centers, k);
+        } else if (status == 0) {
+            status = init_kmeans_parallel(&global_points, args, num_threads_max, centers, k);
         }
+        seeding_free(num_threads_max);
+        if (status != 0) {
+            fprintf(stderr, "Ошибка выделения памяти\n");
+        }
+    }
+    replicate_centers();
+    clock_gettime(CLOCK_MONOTONIC, &seeded);
+
+    StatsWriter stats_writer;
+    if (stats_path) {
+        if (stats_writer_open(&stats_writer, stats_path, stats_format, total_points, k, dim, num_threads_max,
+                              algorithm) != 0) {
+            fprintf(stderr, "Не удалось создать файл статистики %s\n", stats_path);
+            status = -1;
+        }
+        collect_inertia = 1;
+    }
+
+    if (input_path) {
+        status = run_minibatch(&reader, args, k, epochs, labels_path, labels_format);
+    }
+
+    IterationStats stats = {0};
+    int converged = 0;
+    if (processes && status == 0) {
+        if (process_group_init(transport, num_threads_max, k, dim, total_points, centers) != 0) {
+            fprintf(stderr, "Ошибка создания общей памяти процессов\n");
+            status = -1;
+        } else {
+            status = run_processes(args, centers, k, max_iterations, tolerance, &iter, &converged,
+                                   &stats.max_shift);
+        }
+    }
+    if (sweep_list && status == 0) {
+        run_sweep(args, num_threads_max, max_iterations, tolerance);
+    }
+    while (!input_path && !processes && !sweep_list && status == 0 && moved > 0 && !converged && iter < max_iterations) {
+        iter++;
 
-        recalculate_centers(global_points, total_points, centers, k);
+        struct timespec iteration_started, bounds_done, iteration_done;
+        clock_gettime(CLOCK_MONOTONIC, &iteration_started);
+        if (algorithm != ALGO_LLOYD) {
+            update_center_bounds(centers, k, dim);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &bounds_done);
+        pool_iteration();
+        clock_gettime(CLOCK_MONOTONIC, &iteration_done);
+        pruning.first_pass = 0;
+
+        stats = collect_iteration_stats(args, num_threads_max, iter,
+                                        elapsed_seconds(&iteration_started, &iteration_done),
+                                        elapsed_seconds(&iteration_started, &bounds_done));
+        moved = stats.moved;
+        converged = tolerance > 0 && stats.max_shift < tolerance;
+        if (stats_path) {
+            stats_writer_write(&stats_writer, &stats);
+        }
 
         printf("Итерация %d завершена, изменения: %s\n", 
-               iter, atomic_load(&changed) ? "да" : "нет");
+               iter, moved > 0 ? "да" : "нет");
+    }
+
+    if (stats_path && status == 0 && stats_writer_close(&stats_writer) != 0) {
+        fprintf(stderr, "Ошибка записи файла статистики %s\n", stats_path);
+        status = -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+
+    if (!processes) {
+        atomic_store(&pool_running, 0);
+        pthread_barrier_wait(&iteration_barrier);
+        for (int t = 0; t < num_threads_max; t++) {
+            pthread_join(threads[t], NULL);
+        }
+    }
+    pthread_barrier_destroy(&iteration_barrier);
+    pthread_barrier_destroy(&reduce_barrier);
+    for (int t = 0; t < num_threads_max; t++) {
+        free(thread_sums[t].coords);
+        free(thread_sums[t].count);
+    }
+
+    if (sweep_list) {
+        if (status == 0) {
+            int separate = 0;
+            for (int m = 0; m < sweep.count; m++) {
+                separate += sweep.models[m].iterations;
+            }
+            printf("\n---Результаты---\n");
+            printf("Проходов по точкам: %d (отдельными запусками: %d)\n", sweep.passes, separate);
+            printf("Время: инициализация %s %.3f с, итерации %.3f с\n", init_name ? init_name : "first",
+                   elapsed_seconds(&started, &seeded), elapsed_seconds(&seeded, &finished));
+            printf("\nИнерция по K:\n");
+            for (int m = 0; m < sweep.count; m++) {
+                const SweepModel *model = &sweep.models[m];
+                printf("K=%4d: итераций %3d, инерция %.10g%s\n", model->k, model->iterations, model->inertia,
+                       model->converged ? "" : " (не сошлась)");
+            }
+        }
+        sweep_free(num_threads_max);
+        free(sweep_ks);
+        point_store_free(&global_points);
+        pruning_free();
+        numa_free();
+        free(centers);
+        return status == 0 ? 0 : 1;
+    }
+
+    if (input_path) {
+        if (status == 0) {
+            printf("\n---Результаты---\n");
+            printf("\nЦентры:\n");
+            for (int j = 0; j < k; j++) {
+                printf("Центр %3d: ", j);
+                print_coords(centers + (size_t)j * dim, 1, dim);
+                printf(", точек: %ld\n", center_seen[j]);
+            }
+            if (chunk_size >= 0) {
+                print_thread_load(args, num_threads_max);
+            }
+        }
+        point_reader_close(&reader);
+        point_store_free(&global_points);
+        free(center_seen);
+        free(centers);
+        numa_free();
+        return status == 0 ? 0 : 1;
     }
 
+    if (status != 0) {
+        return 1;
+    }
 
     printf("\n---Результаты---\n");
     printf("Количество итераций: %d\n", iter);
-    
-    printf("\nТочки:\n");
-    for (int i = 0; i < (total_points); i++) {
-        printf("Точка %3d: (%.2f, %.2f) -> Кластер %d\n", 
-               i, global_points[i].x, global_points[i].y, global_points[i].cluster_id);
+    printf("Время: инициализация %s %.3f с, итерации %.3f с\n", init_name ? init_name : "first",
+           (seeded.tv_sec - started.tv_sec) + (seeded.tv_nsec - started.tv_nsec) / 1e9,
+           (finished.tv_sec - seeded.tv_sec) + (finished.tv_nsec - seeded.tv_nsec) / 1e9);
+    if (processes) {
+        printf("Обмен %s: %.3f с из %.3f с итераций (%.1f%%), байт за итерацию: %zu\n",
+               transport_names[transport], group.exchange_seconds, group.loop_seconds,
+               group.loop_seconds > 0 ? 100.0 * group.exchange_seconds / group.loop_seconds : 0.0,
+               group.bytes_per_iteration);
+        process_group_free();
+    }
+    if (converged) {
+        printf("Сходимость: наибольший сдвиг центра %.3g меньше %g\n", stats.max_shift, tolerance);
+    }
+    if (algorithm != ALGO_LLOYD) {
+        long computed = 0;
+        for (int t = 0; t < num_threads_max; t++) {
+            computed += args[t].distances;
+        }
+        double brute = (double)total_points * k * iter;
+        printf("Вычислено расстояний: %ld из %.0f (пропущено %.1f%%)\n",
+               computed, brute, brute > 0 ? 100.0 * (1 - computed / brute) : 0.0);
+    }
+    if (chunk_size >= 0) {
+        print_thread_load(args, num_threads_max);
+    }
+
+    if (labels_path) {
+        LabelWriter labels;
+        if (label_writer_open(&labels, labels_path, labels_format, total_points, k) != 0) {
+            fprintf(stderr, "Не удалось создать файл меток %s\n", labels_path);
+            return 1;
+        }
+        label_writer_write(&labels, global_points.cluster_id, total_points);
+        if (label_writer_close(&labels) != 0) {
+            fprintf(stderr, "Ошибка записи файла меток %s\n", labels_path);
+            return 1;
+        }
+    }
+
+    if (!quiet) {
+        printf("\nТочки:\n");
+        for (int i = 0; i < (total_points); i++) {
+            printf("Точка %3d: ", i);
+            print_coords(point_base(&global_points, i, dim), POINT_BLOCK, dim);
+            printf(" -> Кластер %d\n", global_points.cluster_id[i]);
+        }
     }
 
-    free(global_points);
+    point_store_free(&global_points);
+    pruning_free();
+    numa_free();
     free(centers);
 
     return 0;